@@ -0,0 +1,104 @@
+#ifndef ADC_CALIBRATION_H
+#define ADC_CALIBRATION_H
+
+#include <Arduino.h>
+#include <esp_adc_cal.h>
+#include "config.h"
+
+// Linearization of the ESP32 ADC using the chip's eFuse calibration.
+// The esp_adc_cal curve is sampled once at startup into a small table that
+// maps raw 12-bit codes to ideal ratiometric codes (as if the ADC were
+// perfectly linear over the NTC supply voltage), so each sample only costs
+// one interpolation.
+class AdcCalibration {
+public:
+    enum Source {
+        SOURCE_NONE,          // Calibration disabled, identity mapping
+        SOURCE_DEFAULT_VREF,  // No eFuse data, default reference voltage
+        SOURCE_EFUSE_VREF,    // eFuse reference voltage
+        SOURCE_EFUSE_TP       // eFuse two-point values
+    };
+
+    AdcCalibration() : source(SOURCE_NONE) {
+        for (int i = 0; i < KNOT_COUNT; i++) {
+            knots[i] = knotCode(i);
+        }
+    }
+
+    void begin() {
+        // The conversion assumes 12-bit codes and the attenuation used for characterization
+        analogReadResolution(12);
+        analogSetAttenuation(ADC_11db);
+
+#if ADC_USE_EFUSE_CALIBRATION
+        esp_adc_cal_characteristics_t characteristics;
+        esp_adc_cal_value_t type = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_CAL_WIDTH,
+                                                            ADC_DEFAULT_VREF, &characteristics);
+
+        if (type == ESP_ADC_CAL_VAL_EFUSE_TP) {
+            source = SOURCE_EFUSE_TP;
+        } else if (type == ESP_ADC_CAL_VAL_EFUSE_VREF) {
+            source = SOURCE_EFUSE_VREF;
+        } else {
+            source = SOURCE_DEFAULT_VREF;
+        }
+
+        // Sample the characteristic curve once into the knot table
+        for (int i = 0; i < KNOT_COUNT; i++) {
+            uint32_t millivolts = esp_adc_cal_raw_to_voltage(knotCode(i) << ADC_CAL_SHIFT, &characteristics);
+            knots[i] = (float)millivolts * ADC_FULL_SCALE / NTC_SUPPLY_MILLIVOLTS;
+        }
+#endif
+    }
+
+    // Map a raw (possibly fractional) 12-bit code to a linearized code
+    float correct(float rawCode) const {
+        if (source == SOURCE_NONE || rawCode <= 0 || rawCode >= ADC_FULL_SCALE) {
+            // Keep rail readings on the rails so fault detection still sees them
+            return rawCode;
+        }
+
+        // The last segment ends at full scale, one code short of KNOT_STEP
+        int index = (int)(rawCode / KNOT_STEP);
+        int start = knotCode(index);
+        float fraction = (rawCode - start) / (knotCode(index + 1) - start);
+        return knots[index] + (knots[index + 1] - knots[index]) * fraction;
+    }
+
+    Source getSource() const {
+        return source;
+    }
+
+    const char* getSourceName() const {
+        switch (source) {
+            case SOURCE_EFUSE_TP: return "efuse_tp";
+            case SOURCE_EFUSE_VREF: return "efuse_vref";
+            case SOURCE_DEFAULT_VREF: return "default_vref";
+            default: return "none";
+        }
+    }
+
+private:
+    static constexpr int ADC_FULL_SCALE = 4095;
+    static constexpr int KNOT_STEP = 64;
+    static constexpr int KNOT_COUNT = 4096 / KNOT_STEP + 1;
+
+#if CONFIG_IDF_TARGET_ESP32S2
+    // The ESP32-S2 characterization works on 13-bit readings
+    static constexpr adc_bits_width_t ADC_CAL_WIDTH = ADC_WIDTH_BIT_13;
+    static constexpr int ADC_CAL_SHIFT = 1;
+#else
+    static constexpr adc_bits_width_t ADC_CAL_WIDTH = ADC_WIDTH_BIT_12;
+    static constexpr int ADC_CAL_SHIFT = 0;
+#endif
+
+    // Raw code sampled by each knot
+    static constexpr int knotCode(int index) {
+        return index * KNOT_STEP < ADC_FULL_SCALE ? index * KNOT_STEP : ADC_FULL_SCALE;
+    }
+
+    float knots[KNOT_COUNT];
+    Source source;
+};
+
+#endif // ADC_CALIBRATION_H
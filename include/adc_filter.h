@@ -0,0 +1,139 @@
+#ifndef ADC_FILTER_H
+#define ADC_FILTER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Filter stage for one ADC channel: keeps a ring buffer of raw samples,
+// rejects spikes with a sliding median and smooths the median output
+// with a first-order IIR low-pass.
+class AdcFilter {
+public:
+    struct Settings {
+        uint8_t medianWindow;  // Number of samples in the median (odd)
+        float iirAlpha;        // IIR smoothing factor (0-1, lower = smoother)
+    };
+
+    AdcFilter() {
+        reset();
+    }
+
+    void reset() {
+        head = 0;
+        count = 0;
+        rawSum = 0;
+        rawSumSq = 0;
+        value = 0;
+        lastRaw = 0;
+        for (int i = 0; i < SENSOR_RING_SIZE; i++) {
+            rawRing[i] = 0;
+            filteredRing[i] = 0;
+        }
+    }
+
+    // Add a new raw sample and return the filtered value (in ADC codes)
+    float push(uint16_t raw, const Settings& settings) {
+        // Keep running sums so the noise statistics are O(1) per sample
+        if (count == SENSOR_RING_SIZE) {
+            uint16_t oldest = rawRing[head];
+            rawSum -= oldest;
+            rawSumSq -= (uint64_t)oldest * oldest;
+        } else {
+            count++;
+        }
+
+        rawRing[head] = raw;
+        rawSum += raw;
+        rawSumSq += (uint64_t)raw * raw;
+        lastRaw = raw;
+
+        float median = computeMedian(settings.medianWindow);
+
+        // Seed the IIR with the first median so the output does not ramp from zero
+        if (count == 1) {
+            value = median;
+        } else {
+            value += settings.iirAlpha * (median - value);
+        }
+
+        filteredRing[head] = value;
+        head = (head + 1) % SENSOR_RING_SIZE;
+
+        return value;
+    }
+
+    float getValue() const {
+        return value;
+    }
+
+    uint16_t getLastRaw() const {
+        return lastRaw;
+    }
+
+    bool hasData() const {
+        return count > 0;
+    }
+
+    // Standard deviation of the raw samples in the ring (ADC codes). The sums are exact
+    // integers, so count^2 x variance is too: only the final division and root round
+    float getRawStdDev() const {
+        if (count < 2) return 0;
+        int64_t scaled = (int64_t)count * (int64_t)rawSumSq - (int64_t)rawSum * rawSum;
+        return scaled > 0 ? sqrtf((float)scaled) / count : 0;
+    }
+
+    // Standard deviation of the filtered output over the same window (ADC codes). Two
+    // passes: summing squared deviations from the mean, instead of subtracting the squared
+    // mean from the mean square, keeps sub-code noise on a ~2000 code signal in float
+    float getFilteredStdDev() const {
+        if (count < 2) return 0;
+        float sum = 0;
+        for (int i = 0; i < count; i++) {
+            sum += filteredRing[i];
+        }
+        float mean = sum / count;
+
+        float squares = 0;
+        for (int i = 0; i < count; i++) {
+            float deviation = filteredRing[i] - mean;
+            squares += deviation * deviation;
+        }
+        return sqrtf(squares / count);
+    }
+
+private:
+    // Median of the most recent samples (insertion sort, window is small)
+    float computeMedian(uint8_t window) const {
+        int n = min((int)window, (int)count);
+        if (n < 1) n = 1;
+
+        uint16_t samples[SENSOR_MEDIAN_MAX];
+        int index = head;
+        for (int i = 0; i < n; i++) {
+            uint16_t sample = rawRing[index];
+            int j = i;
+            while (j > 0 && samples[j - 1] > sample) {
+                samples[j] = samples[j - 1];
+                j--;
+            }
+            samples[j] = sample;
+            index = (index + SENSOR_RING_SIZE - 1) % SENSOR_RING_SIZE;
+        }
+
+        if (n % 2 == 1) {
+            return samples[n / 2];
+        }
+        return (samples[n / 2 - 1] + samples[n / 2]) / 2.0f;
+    }
+
+    uint16_t rawRing[SENSOR_RING_SIZE];
+    float filteredRing[SENSOR_RING_SIZE];
+    int head;
+    int count;
+    uint32_t rawSum;
+    uint64_t rawSumSq;
+    float value;
+    uint16_t lastRaw;
+};
+
+#endif // ADC_FILTER_H
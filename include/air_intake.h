@@ -3,70 +3,81 @@
 
 #include <Arduino.h>
 #include <ESP32Servo.h>
-#include <PID_v1.h>
+#include "pid_controller.h" // In-tree PID (float or Q16.16 fixed point)
 #include "pid_autotune.h" // Our own auto-tuning implementation
 #include "config.h"
 
 class AirIntake {
 public:
-    AirIntake() : pid(&input, &output, &setpoint, PID_KP, PID_KI, PID_KD, DIRECT) {
+    AirIntake() : pid(PID_KP, PID_KI, PID_KD) {
         setpoint = DEFAULT_TARGET_BURNING_TEMP;
         servoMin = DEFAULT_SERVO_MIN;
         servoMax = DEFAULT_SERVO_MAX;
     }
 
     void begin() {
+        // Driven by the control task and the safety supervisor. A mutex, not a spinlock:
+        // servo.write() is a driver call and must not run with interrupts masked
+        servoMutex = xSemaphoreCreateMutex();
+
         // Attach servo to pin
         servo.attach(SERVO_AIR_INTAKE);
 
         // Configure PID
-        pid.SetMode(AUTOMATIC);
-        pid.SetSampleTime(PID_SAMPLE_TIME);
-        pid.SetOutputLimits(0, 100);  // Output in percentage (0-100%)
+        pid.setSampleTime(PID_SAMPLE_TIME);
+        pid.setOutputLimits(0, 100);  // Output in percentage (0-100%)
+        pid.setMode(AirIntakePID::AUTOMATIC, input, output);
 
         // Initialize servo in closed position
         setServoPosition(0);  // 0% = air intake closed
     }
 
-    void update(float currentBurningTemperature) {
+    // One control step. now is the scheduled time of the step (ms), so the PID sees
+    // the nominal period rather than the wake-up jitter of the calling task
+    void update(float currentBurningTemperature, unsigned long now) {
         input = currentBurningTemperature;
+        lastUpdate = now;
 
         if (tuningInProgress) {
-            unsigned long now = millis();
-
-            if (now - lastTuneTime > PID_SAMPLE_TIME) {
-                lastTuneTime = now;
+            // The relay starts on the control time base at the first step after the request
+            if (tuningStartPending) {
+                autoTune.start(now);
+                tuningStartPending = false;
+            }
 
-                // Execute one step of auto-tuning
-                bool tuningResult = autoTune.compute();
+            // Execute one step of auto-tuning
+            bool tuningFinished = autoTune.compute(input, now);
+            output = autoTune.getOutput();
 
-                // If auto-tuning is complete
-                if (tuningResult) {
-                    tuningInProgress = false;
+            if (tuningFinished) {
+                tuningInProgress = false;
 
+                if (autoTune.getState() == PIDAutoTune::STATE_DONE) {
                     // Get the calculated PID parameters
-                    double kp = autoTune.getKp();
-                    double ki = autoTune.getKi();
-                    double kd = autoTune.getKd();
+                    float kp = autoTune.getKp();
+                    float ki = autoTune.getKi();
+                    float kd = autoTune.getKd();
 
                     // Update the PID controller with new parameters
-                    pid.SetTunings(kp, ki, kd);
+                    pid.setTunings(kp, ki, kd);
 
                     // Save parameters for reference
                     currentKp = kp;
                     currentKi = ki;
                     currentKd = kd;
-
-                    // Restore normal control
-                    pid.SetMode(AUTOMATIC);
                 }
 
-                // Update servo position
-                setServoPosition(output);
+                // Restore normal control (previous gains are kept if tuning failed)
+                pid.setMode(AirIntakePID::AUTOMATIC, input, output);
             }
+
+            // Update servo position
+            setServoPosition(output);
         } else {
             // Normal PID operation
-            pid.Compute();
+            if (pid.compute(input, setpoint, now)) {
+                output = pid.getOutput();
+            }
             setServoPosition(output);
         }
     }
@@ -87,24 +98,17 @@ public:
     bool startAutoTune() {
         // Only start if there's no auto-tuning in progress
         if (!tuningInProgress) {
-            // Save current parameters
-            double prevKp = pid.GetKp();
-            double prevKi = pid.GetKi();
-            double prevKd = pid.GetKd();
-
             // Prepare for auto-tuning
-            pid.SetMode(MANUAL);
+            pid.setMode(AirIntakePID::MANUAL, input, output);
 
             // Configure auto-tuning with our implementation
             PIDAutoTune::ControlType controlType = PID_CONTROL_TYPE == 0 ? PIDAutoTune::PID_TYPE :
                                                  (PID_CONTROL_TYPE == 1 ? PIDAutoTune::PI_TYPE :
                                                                          PIDAutoTune::P_TYPE);
 
-            autoTune.init(&input, &output, setpoint, PID_OUTPUT_STEP, PID_NOISE_BAND, controlType);
-            autoTune.start();
-
+            autoTune.init(setpoint, output, PID_OUTPUT_STEP, PID_NOISE_BAND, controlType);
+            tuningStartPending = true;
             tuningInProgress = true;
-            lastTuneTime = millis();
 
             return true;
         }
@@ -115,10 +119,11 @@ public:
     void cancelAutoTune() {
         if (tuningInProgress) {
             tuningInProgress = false;
-            autoTune.cancel();
+            tuningStartPending = false;
+            autoTune.cancel(lastUpdate);
 
             // Restore normal PID control
-            pid.SetMode(AUTOMATIC);
+            pid.setMode(AirIntakePID::AUTOMATIC, input, output);
         }
     }
 
@@ -127,16 +132,39 @@ public:
         return tuningInProgress;
     }
 
+    // Progress of the current (or last) auto-tuning: cycles measured, Ku/Tu estimates
+    PIDAutoTune::Status getAutoTuneStatus() const {
+        return autoTune.getStatus(lastUpdate);
+    }
+
     // Get current PID parameters
-    double getKp() const { return currentKp; }
-    double getKi() const { return currentKi; }
-    double getKd() const { return currentKd; }
+    float getKp() const { return currentKp; }
+    float getKi() const { return currentKi; }
+    float getKd() const { return currentKd; }
 
     // Directly set servo position (for emergency control from outside)
     void setPosition(int percentage) {
         setServoPosition(percentage);
     }
 
+    // Take over the servo (safety supervisor). PID and setPosition() are ignored until releasePosition()
+    void forcePosition(int percentage) {
+        lockServo();
+        forced = true;
+        writeServo(percentage);
+        unlockServo();
+    }
+
+    void releasePosition() {
+        lockServo();
+        forced = false;
+        unlockServo();
+    }
+
+    bool isForced() const {
+        return forced;
+    }
+
     // Set minimum servo position (0% air)
     void setServoMin(int minPos) {
         if (minPos >= 0 && minPos < servoMax) {
@@ -162,8 +190,16 @@ public:
     }
 
 private:
-    // Convert percentage (0-100%) to actual servo angle (servoMin-servoMax)
     void setServoPosition(int percentage) {
+        lockServo();
+        if (!forced) {
+            writeServo(percentage);
+        }
+        unlockServo();
+    }
+
+    // Convert percentage (0-100%) to actual servo angle (servoMin-servoMax)
+    void writeServo(int percentage) {
         // Ensure percentage is within bounds
         percentage = constrain(percentage, 0, 100);
 
@@ -175,25 +211,36 @@ private:
         currentPosition = percentage;
     }
 
+    void lockServo() {
+        if (servoMutex) xSemaphoreTake(servoMutex, portMAX_DELAY);
+    }
+
+    void unlockServo() {
+        if (servoMutex) xSemaphoreGive(servoMutex);
+    }
+
     Servo servo;
-    double input = 0;     // Current combustion temperature
-    double output = 0;    // Air intake percentage (0-100%)
-    double setpoint = 0;  // Target combustion temperature
-    PID pid;
+    float input = 0;     // Current combustion temperature
+    float output = 0;    // Air intake percentage (0-100%)
+    float setpoint = 0;  // Target combustion temperature
+    AirIntakePID pid;
     PIDAutoTune autoTune;
 
     bool tuningInProgress = false;
-    unsigned long lastTuneTime = 0;
+    bool tuningStartPending = false;
+    unsigned long lastUpdate = 0;  // Time of the last control step (ms)
     int currentPosition = 0;  // Current percentage position
+    volatile bool forced = false;  // Servo held by the safety supervisor
+    SemaphoreHandle_t servoMutex = nullptr;
 
     // Servo range limits
     int servoMin;  // Servo position at 0% air
     int servoMax;  // Servo position at 100% air
 
     // Current PID parameters
-    double currentKp = PID_KP;
-    double currentKi = PID_KI;
-    double currentKd = PID_KD;
+    float currentKp = PID_KP;
+    float currentKi = PID_KI;
+    float currentKd = PID_KD;
 };
 
 #endif // AIR_INTAKE_H
\ No newline at end of file
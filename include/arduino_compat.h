@@ -0,0 +1,73 @@
+#ifndef ARDUINO_COMPAT_H
+#define ARDUINO_COMPAT_H
+
+// The part of the Arduino core used by the headers that also build on the host, which
+// include this instead of Arduino.h. On the device this is Arduino.h; in the native
+// environment (pio test -e native) the same names come from the C++ library, so that
+// code can be tested and benchmarked without a board
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <strings.h>
+
+using std::isinf;
+using std::isnan;
+using std::max;
+using std::min;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+inline unsigned long micros() {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline unsigned long millis() {
+    return micros() / 1000;
+}
+
+// Byte sink of the Arduino core, for classes that serialize into one
+class Print {
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t written = 0;
+        while (size--) {
+            written += write(*buffer++);
+        }
+        return written;
+    }
+
+    size_t write(const char* text) {
+        return write((const uint8_t*)text, strlen(text));
+    }
+};
+
+// FreeRTOS mutexes, for classes that lock only once begin() created theirs: on the host
+// there is a single thread and no mutex is ever created
+typedef void* SemaphoreHandle_t;
+#define portMAX_DELAY 0xFFFFFFFFUL
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return nullptr;
+}
+
+inline bool xSemaphoreTake(SemaphoreHandle_t, unsigned long) {
+    return true;
+}
+
+inline bool xSemaphoreGive(SemaphoreHandle_t) {
+    return true;
+}
+#endif
+
+#endif // ARDUINO_COMPAT_H
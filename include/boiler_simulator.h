@@ -0,0 +1,92 @@
+#ifndef BOILER_SIMULATOR_H
+#define BOILER_SIMULATOR_H
+
+#include "arduino_compat.h"
+
+// Thermal model of the boiler used to evaluate the air intake control without a live fire.
+// Firebox: first order plus dead time response of the combustion temperature to the air
+// intake, scaled by the amount of fuel. Water jacket (optional second mass): heated by
+// the firebox and cooled by the heating circuit.
+// Only plain arithmetic is used, so it also builds on a host compiler.
+class BoilerSimulator {
+public:
+    struct Params {
+        float ambient;         // Ambient temperature (Celsius)
+        float gain;            // Steady state combustion rise per % of air at full fuel load (Celsius/%)
+        float timeConstant;    // Firebox time constant (s)
+        float deadTime;        // Transport delay between air intake and combustion temperature (s)
+        float jacketCoupling;  // Heat transfer firebox -> water jacket (1/s)
+        float jacketLoss;      // Heat drawn by the heating circuit (1/s)
+    };
+
+    static Params defaultParams() {
+        Params params;
+        params.ambient = 20.0;
+        params.gain = 2.0;
+        params.timeConstant = 120.0;
+        params.deadTime = 20.0;
+        params.jacketCoupling = 0.002;
+        params.jacketLoss = 0.001;
+        return params;
+    }
+
+    BoilerSimulator(const Params& params, float stepSeconds) : params(params), stepSeconds(stepSeconds) {
+        reset(params.ambient, params.ambient);
+    }
+
+    void reset(float fireboxTemp, float waterTemp) {
+        firebox = fireboxTemp;
+        water = waterTemp;
+        fuel = 1.0;
+        delayHead = 0;
+        for (int i = 0; i < MAX_DELAY_STEPS; i++) {
+            delayLine[i] = 0;
+        }
+    }
+
+    // Amount of fuel relative to a full load (1.0). Models fuel loads, refuels and burn-down
+    void setFuel(float fuelFactor) {
+        fuel = max(fuelFactor, 0.0f);
+    }
+
+    float getFuel() const {
+        return fuel;
+    }
+
+    // Advance the model by one step with the given air intake position (0-100%)
+    void step(float airPercent) {
+        // Dead time: the firebox reacts to the air intake position of deadTime seconds ago
+        int delaySteps = constrain((int)(params.deadTime / stepSeconds), 0, MAX_DELAY_STEPS - 1);
+        delayLine[delayHead] = constrain(airPercent, 0.0f, 100.0f);
+        float delayedAir = delayLine[(delayHead + MAX_DELAY_STEPS - delaySteps) % MAX_DELAY_STEPS];
+        delayHead = (delayHead + 1) % MAX_DELAY_STEPS;
+
+        // Firebox: first order lag towards the equilibrium set by air and fuel
+        float equilibrium = params.ambient + params.gain * fuel * delayedAir;
+        firebox += (equilibrium - firebox) * stepSeconds / params.timeConstant;
+
+        // Water jacket: heated by the firebox, cooled by the heating circuit
+        water += ((firebox - water) * params.jacketCoupling - (water - params.ambient) * params.jacketLoss) * stepSeconds;
+    }
+
+    float getFireboxTemperature() const {
+        return firebox;
+    }
+
+    float getWaterTemperature() const {
+        return water;
+    }
+
+private:
+    static constexpr int MAX_DELAY_STEPS = 256;
+
+    Params params;
+    float stepSeconds;
+    float firebox;
+    float water;
+    float fuel;
+    float delayLine[MAX_DELAY_STEPS];
+    int delayHead;
+};
+
+#endif // BOILER_SIMULATOR_H
@@ -0,0 +1,266 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+#include "state_buffer.h"
+
+// Change requested from outside the control task (web API or MQTT)
+struct Command {
+    enum Type {
+        TARGET_TEMPERATURE = 0,   // value[0]: Celsius
+        SERVO_MIN,                // value[0]: servo angle
+        SERVO_MAX,                // value[0]: servo angle
+        AUTOTUNE,                 // Start auto-tuning, or cancel the one in progress
+        RELAY,                    // channel: relay (RELAY_ID_*), value[0]: 1 = on
+        SENSOR_FILTER,            // channel, value: sample period, median window, IIR alpha (NAN = keep)
+        CALIBRATION,              // channel, value: measured low, reference low, measured high, reference high
+        CALIBRATION_RESET,        // channel
+        TYPE_COUNT
+    };
+
+    enum Source {
+        SOURCE_WEB = 0,
+        SOURCE_MQTT
+    };
+
+    enum RelayId {
+        RELAY_ID_BOILER_PUMP = 0,
+        RELAY_ID_HEATING_PUMP,
+        RELAY_ID_FANS,
+        RELAY_ID_OTHER,
+        RELAY_ID_COUNT
+    };
+
+    Type type;
+    Source source;
+    int channel;
+    float value[4];
+    uint32_t id;          // Assigned by submit()
+    uint32_t queuedAt;    // micros() at submit()
+
+    static const char* typeName(Type type) {
+        switch (type) {
+            case TARGET_TEMPERATURE: return "target_burning_temp";
+            case SERVO_MIN: return "servo_min";
+            case SERVO_MAX: return "servo_max";
+            case AUTOTUNE: return "autotune";
+            case RELAY: return "relay";
+            case SENSOR_FILTER: return "sensor_filter";
+            case CALIBRATION: return "calibration";
+            case CALIBRATION_RESET: return "calibration_reset";
+            default: return "unknown";
+        }
+    }
+};
+
+// Outcome of a command. reason is a static string, nullptr unless rejected
+struct CommandResult {
+    enum Status {
+        STATUS_QUEUED = 0,    // Waiting for the control task
+        STATUS_APPLIED,
+        STATUS_REJECTED
+    };
+
+    uint32_t id;
+    Command::Type type;
+    Command::Source source;
+    Status status;
+    const char* reason;
+    uint32_t latency;     // submit() -> applied or rejected by the control task (us)
+
+    static const char* statusName(Status status) {
+        switch (status) {
+            case STATUS_QUEUED: return "queued";
+            case STATUS_APPLIED: return "applied";
+            case STATUS_REJECTED: return "rejected";
+            default: return "unknown";
+        }
+    }
+};
+
+// Bounded queue of commands for the control task.
+// Any task may submit(); only the control task takes commands with next() and reports
+// their outcome with complete(), at a fixed point of its cycle. Submitting never blocks:
+// each slot carries a sequence number (bounded MPMC queue by D. Vyukov), so producers
+// only race on one compare-and-swap, and a full queue rejects the command at once.
+// Requests that can be checked without controller state are validated on submit()
+class CommandQueue {
+public:
+    static const int CAPACITY = COMMAND_QUEUE_SIZE;   // Power of two
+
+    struct Stats {
+        uint32_t submitted;     // Commands accepted into the queue
+        uint32_t applied;
+        uint32_t rejected;      // On submit() or by the control task
+        uint32_t dropped;       // Queue full
+        uint32_t lastLatency;   // submit() -> outcome (us)
+        uint32_t maxLatency;
+    };
+
+    // Last COMMAND_HISTORY outcomes, newest last
+    struct History {
+        CommandResult results[COMMAND_HISTORY];
+        int count;
+    };
+
+    CommandQueue() : enqueuePos(0), dequeuePos(0), nextId(1), submitted(0), rejected(0), dropped(0),
+                     applied(0), lastLatency(0), maxLatency(0) {
+        static_assert((CAPACITY & (CAPACITY - 1)) == 0, "COMMAND_QUEUE_SIZE must be a power of two");
+        for (int i = 0; i < CAPACITY; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        history.count = 0;
+    }
+
+    // Validate and queue a command. The result is STATUS_QUEUED or STATUS_REJECTED
+    CommandResult submit(Command command) {
+        command.id = nextId.fetch_add(1, std::memory_order_relaxed);
+        command.queuedAt = micros();
+
+        CommandResult result = {command.id, command.type, command.source, CommandResult::STATUS_QUEUED, nullptr, 0};
+        result.reason = validate(command);
+        if (result.reason) {
+            result.status = CommandResult::STATUS_REJECTED;
+            rejected.fetch_add(1, std::memory_order_relaxed);
+            return result;
+        }
+
+        if (!push(command)) {
+            result.status = CommandResult::STATUS_REJECTED;
+            result.reason = "queue_full";
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return result;
+        }
+        submitted.fetch_add(1, std::memory_order_relaxed);
+        return result;
+    }
+
+    // Control task: take the oldest command
+    bool next(Command& command) {
+        uint32_t pos = dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & (CAPACITY - 1)];
+            int32_t diff = (int32_t)cell.sequence.load(std::memory_order_acquire) - (int32_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    command = cell.command;
+                    cell.sequence.store(pos + CAPACITY, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // Empty
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Control task: record the outcome of a command taken with next(). reason = nullptr if applied
+    void complete(const Command& command, const char* reason) {
+        CommandResult result = {command.id, command.type, command.source,
+                                reason ? CommandResult::STATUS_REJECTED : CommandResult::STATUS_APPLIED,
+                                reason, micros() - command.queuedAt};
+        if (reason) {
+            rejected.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            applied++;
+        }
+        lastLatency = result.latency;
+        maxLatency = max(maxLatency, result.latency);
+
+        if (history.count == COMMAND_HISTORY) {
+            memmove(history.results, history.results + 1, sizeof(CommandResult) * (COMMAND_HISTORY - 1));
+            history.count--;
+        }
+        history.results[history.count++] = result;
+        published.publish(history);
+    }
+
+    // Recent outcomes, safe from any task. Returns how many times the history changed
+    uint32_t getHistory(History& copy) const {
+        return published.read(copy);
+    }
+
+    Stats getStats() const {
+        Stats stats;
+        stats.submitted = submitted.load(std::memory_order_relaxed);
+        stats.applied = applied;
+        stats.rejected = rejected.load(std::memory_order_relaxed);
+        stats.dropped = dropped.load(std::memory_order_relaxed);
+        stats.lastLatency = lastLatency;
+        stats.maxLatency = maxLatency;
+        return stats;
+    }
+
+private:
+    struct Cell {
+        std::atomic<uint32_t> sequence;
+        Command command;
+    };
+
+    bool push(const Command& command) {
+        uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & (CAPACITY - 1)];
+            int32_t diff = (int32_t)cell.sequence.load(std::memory_order_acquire) - (int32_t)pos;
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.command = command;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // Full
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Checks that do not depend on the controller state. Returns the rejection reason
+    static const char* validate(const Command& command) {
+        switch (command.type) {
+            case Command::TARGET_TEMPERATURE:
+                if (isnan(command.value[0]) || command.value[0] < TARGET_BURNING_TEMP_MIN ||
+                    command.value[0] > TARGET_BURNING_TEMP_MAX) {
+                    return "out_of_range";
+                }
+                return nullptr;
+            case Command::SERVO_MIN:
+            case Command::SERVO_MAX:
+                if (isnan(command.value[0]) || command.value[0] < 0 || command.value[0] > 180) {
+                    return "out_of_range";
+                }
+                return nullptr;
+            case Command::RELAY:
+                return command.channel >= 0 && command.channel < Command::RELAY_ID_COUNT ? nullptr : "unknown_relay";
+            case Command::SENSOR_FILTER:
+            case Command::CALIBRATION:
+            case Command::CALIBRATION_RESET:
+                return command.channel >= 0 && command.channel < SENSOR_CHANNEL_COUNT ? nullptr : "unknown_channel";
+            case Command::AUTOTUNE:
+                return nullptr;
+            default:
+                return "unknown_command";
+        }
+    }
+
+    Cell cells[CAPACITY];
+    std::atomic<uint32_t> enqueuePos;
+    std::atomic<uint32_t> dequeuePos;
+    std::atomic<uint32_t> nextId;
+    std::atomic<uint32_t> submitted;
+    std::atomic<uint32_t> rejected;
+    std::atomic<uint32_t> dropped;
+
+    // Control task only
+    uint32_t applied;
+    uint32_t lastLatency;
+    uint32_t maxLatency;
+    History history;
+    StateBuffer<History> published;
+};
+
+#endif // COMMAND_QUEUE_H
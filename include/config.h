@@ -10,6 +10,65 @@
 // Series resistor for NTC thermistors (in ohms)
 #define NTC_SERIES_RESISTOR            10000
 
+// Background ADC acquisition for NTC thermistors
+#define SENSOR_SAMPLE_INTERVAL         10    // Tick of the background sampler, shortest channel period (ms)
+#define SENSOR_READ_INTERVAL           250   // Control task period: sensor snapshot and safety evaluation (ms)
+#define SENSOR_OVERSAMPLING            4     // ADC conversions averaged into each sample
+#define SENSOR_RING_SIZE               32    // Samples kept per channel (median input and noise stats)
+#define SENSOR_MEDIAN_MAX              15    // Maximum allowed median filter length
+
+// Control task (sensor snapshot, safety evaluation and PID step at a fixed period)
+#define CONTROL_TASK_PRIORITY          5     // Above the sampler, loop() and the web server tasks
+#define CONTROL_TASK_STACK             4096
+#define LOOP_JITTER_BIN                50    // Resolution of the period jitter histogram (us)
+#define LOOP_JITTER_BINS               128   // Jitter above LOOP_JITTER_BIN * LOOP_JITTER_BINS lands in the last bin
+
+// Safety supervisor (independent overheat protection on the boiler water NTC)
+#define SAFETY_TASK_PRIORITY           10    // Highest of the application tasks
+#define SAFETY_TASK_STACK              3072
+#define SAFETY_SAMPLE_INTERVAL         10    // Direct boiler water reading period (ms)
+#define SAFETY_TRIP_SAMPLES            3     // Consecutive samples over the limit to trip
+#define SAFETY_CLEAR_SAMPLES           100   // Consecutive samples below the exit limit to release
+#define SAFETY_HYSTERESIS              5.0   // Release below BOILER_WATER_CRITICAL_TEMP minus this (degrees C)
+
+// Per-channel sample period (ms), median filter length (odd) and IIR smoothing factor
+// (0-1, lower = smoother). Combustion is the PID input and changes fast, ambient barely moves.
+#define SENSOR_BOILER_WATER_PERIOD     200
+#define SENSOR_BOILER_WATER_MEDIAN     5
+#define SENSOR_BOILER_WATER_ALPHA      0.2
+#define SENSOR_HEATING_PERIOD          1000
+#define SENSOR_HEATING_MEDIAN          5
+#define SENSOR_HEATING_ALPHA           0.3
+#define SENSOR_BURNING_PERIOD          50    // 20 Hz
+#define SENSOR_BURNING_MEDIAN          5
+#define SENSOR_BURNING_ALPHA           0.3
+#define SENSOR_AMBIENT_PERIOD          5000
+#define SENSOR_AMBIENT_MEDIAN          3
+#define SENSOR_AMBIENT_ALPHA           0.5
+
+// ADC code to temperature conversion per channel
+#define NTC_CONVERSION_FORMULA         0     // Steinhart-Hart evaluated at runtime
+#define NTC_CONVERSION_TABLE           1     // Compile-time lookup table (see ntc_table.h)
+#define NTC_BOILER_WATER_CONVERSION    NTC_CONVERSION_TABLE
+#define NTC_HEATING_CONVERSION         NTC_CONVERSION_TABLE
+#define NTC_BURNING_CONVERSION         NTC_CONVERSION_TABLE
+#define NTC_AMBIENT_CONVERSION         NTC_CONVERSION_TABLE
+
+// ADC calibration
+#define ADC_USE_EFUSE_CALIBRATION      1     // Linearize readings with the chip's eFuse ADC calibration
+#define ADC_DEFAULT_VREF               1100  // Reference voltage used when the eFuse has no data (mV)
+#define NTC_SUPPLY_MILLIVOLTS          3300  // Voltage feeding the NTC dividers (mV)
+
+// NTC fault detection (evaluated on every background sample)
+#define SENSOR_OPEN_CODE               4080  // Raw code at or above this = open thermistor
+#define SENSOR_SHORT_CODE              15    // Raw code at or below this = shorted thermistor
+#define SENSOR_MAX_RATE                20.0  // Maximum plausible temperature change (Celsius/second)
+#define SENSOR_STUCK_TIME              60000 // Identical raw code for this long = stuck channel (ms, 0 = off)
+#define SENSOR_FAULT_SAMPLES           5     // Consecutive bad samples before raising a fault
+#define SENSOR_FAULT_CLEAR_TIME        5000  // Good readings required before clearing a fault (ms)
+#define SENSOR_WARMUP_TIME             2000  // A channel without samples yet is not a fault this long after boot (ms)
+#define SENSOR_FAULT_AIR_POSITION      0     // Air intake position while the burning sensor is faulted (%)
+
 // Pin definitions for solid state relays
 #define RELAY_BOILER_PUMP              12
 #define RELAY_HEATING_PUMP             11
@@ -54,23 +113,73 @@
 #define PID_KI                         0.1
 #define PID_KD                         1.0
 #define PID_SAMPLE_TIME                1000  // Sampling time in milliseconds
+#define PID_USE_FIXED_POINT            0     // 0 = float, 1 = Q16.16 fixed point arithmetic
 
 // Configuration for PID auto-tuning
 #define PID_CONTROL_TYPE               1     // 0=PID, 1=PI, 2=P (PI recommended for temperature control)
-#define PID_NOISE_BAND                 1.0   // Noise band for auto-tuning (degrees C)
-#define PID_OUTPUT_STEP                50    // Output change during auto-tuning (0-180)
-#define PID_LOOKBACK_SEC               30    // Seconds of history to analyze during auto-tuning
+#define PID_NOISE_BAND                 1.0   // Relay hysteresis around the setpoint during auto-tuning (degrees C)
+#define PID_OUTPUT_STEP                50    // Relay swing, peak to peak around the current output (0-100%)
+#define PID_AUTOTUNE_CYCLES            4     // Oscillation cycles averaged for Ku/Tu
+#define PID_AUTOTUNE_MAX_CYCLES        20    // Give up if the cycles have not converged by then
+#define PID_AUTOTUNE_TOLERANCE         0.1   // Max relative deviation of amplitude and period between averaged cycles
+#define PID_AUTOTUNE_TIMEOUT           7200000  // Abort auto-tuning after this long (ms)
+
+// Closed-loop benchmark against the simulated boiler (pio test -e native -f test_control_benchmark)
+#define SIM_SCENARIO_DURATION          3600  // Simulated length of each scenario (s)
+#define SIM_SETTLING_BAND              2.0   // Error band considered settled (degrees C)
+
+// Serialization benchmark of the MQTT state message (GET /api/json_benchmark)
+#define SERIALIZATION_BENCH_RUNS       100   // Messages serialized per method
+#define SERIALIZATION_TASK_PRIORITY    1     // Background run, same priority as loop()
+#define SERIALIZATION_TASK_STACK       6144
 
 // Default setting for desired burning temperature
 #define DEFAULT_TARGET_BURNING_TEMP    85.0  // Default optimal combustion temperature
+#define TARGET_BURNING_TEMP_MIN        60.0  // Lowest target accepted from the web API or MQTT
+#define TARGET_BURNING_TEMP_MAX        100.0 // Highest target accepted from the web API or MQTT
+
+// External commands (web API and MQTT), applied by the control task at the start of a cycle
+#define COMMAND_QUEUE_SIZE             16   // Pending commands (power of two)
+#define COMMAND_HISTORY                8    // Outcomes kept for /api/commands
 
 // Configuration for log buffer
-#define LOG_BUFFER_SIZE                100  // Number of entries in the circular buffer
+#define LOG_ARENA_SIZE                 4096 // Bytes for log records (binary, formatted when read)
+#define LOG_MAX_STRING                 47   // Longest string argument kept in a record (bytes)
+#define LOG_LINE_SIZE                  192  // Longest formatted log line (bytes)
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL              4    // Most verbose level built in (1 error ... 5 trace), override with -D LOG_COMPILE_LEVEL=n
+#endif
+#define LOG_DEFAULT_LEVEL              3    // Runtime level of every source at boot (info), changed via /api/settings
+#define LOG_DRAIN_TASK_PRIORITY        1    // Serial copy of the log, same priority as loop()
+#define LOG_DRAIN_TASK_STACK           3072
+#define LOG_DRAIN_INTERVAL             20   // Pause between Serial passes (ms)
+#define LOG_DRAIN_CHUNK                128  // Largest Serial write (bytes)
+
+// Persistent copy of the log on LittleFS (LogStore), flash budget = segments x segment size
+#define LOG_STORE_DIR                  "/logs"
+#define LOG_STORE_SEGMENT_SIZE         8192 // A segment is closed once it reaches this size (bytes)
+#define LOG_STORE_SEGMENTS             4    // Segments kept, the one being written included
+#define LOG_STORE_BATCH_ENTRIES        20   // Lines written together
+#define LOG_STORE_FLUSH_INTERVAL       30000 // Longest a line waits for its batch, errors are written at once (ms)
+#define LOG_STORE_CHECK_INTERVAL       100  // How often pending lines are checked (ms)
+#define LOG_STORE_CHUNK                256  // Bytes per file write
+#define LOG_STORE_TASK_PRIORITY        1
+#define LOG_STORE_TASK_STACK           4096
+#define LOG_STORE_MAX_LIST             16   // Segments listed by /api/log_segments
 
 // Web interface configuration
 #define HOSTNAME                       "lumber-boiler"
 #define WEB_SERVER_PORT                80
 #define WIFI_RECONNECT_INTERVAL        60000  // Interval to attempt WiFi reconnection (ms)
+#define STATUS_JSON_SIZE               4096   // Cached /api/status JSON, two buffers of this size (bytes)
+
+// Live updates for the web interface (Server-Sent Events on /api/events)
+#define EVENTS_MAX_CLIENTS             4      // Simultaneous event streams, further ones get 404 and poll
+#define EVENTS_MAX_BACKLOG             8      // Average messages waiting per client above which deltas are held back
+#define EVENTS_KEYFRAME_INTERVAL       30000  // Full status sent at least this often, resyncs clients that lost deltas (ms)
+#define EVENTS_TEMP_DEADBAND           0.1    // Temperature change sent as a delta (degrees C)
+#define EVENTS_DELTA_SIZE              512    // Largest state delta message (bytes)
+#define EVENTS_LOG_CHUNK               512    // Largest log event, longer backlogs are split (bytes)
 
 // MQTT configuration for Home Assistant
 #define MQTT_SERVER                    "homeassistant.local"
@@ -79,6 +188,25 @@
 #define MQTT_PASSWORD                  "homeassistant"
 #define MQTT_BASE_TOPIC                "lumber-boiler"
 #define MQTT_CLIENT_ID                 "lumber-boiler-manager"
-#define MQTT_PUBLISH_INTERVAL          10000  // Publishing interval in milliseconds
+#define MQTT_CHECK_INTERVAL            100    // How often the state is checked for changes (ms)
+#define MQTT_MIN_PUBLISH_INTERVAL      1000   // Minimum interval between temperature/air intake updates (ms)
+#define MQTT_MAX_AGE                   60000  // Full state republished at least this often (ms)
+#define MQTT_TEMP_DEADBAND             0.5    // Temperature change that triggers a publish (degrees C)
+#define MQTT_AIR_DEADBAND              2      // Air intake change that triggers a publish (%)
+#define MQTT_PER_FIELD_TOPICS          0      // 1 = one retained topic per field (<base>/state/<field>) instead of a JSON state
+#define MQTT_STREAM_CHUNK              128    // Bytes per socket write when streaming a payload
+
+// Store-and-forward of the state while WiFi or the broker are down, replayed on <base>/replay
+#define TELEMETRY_QUEUE_SIZE           360    // Records kept in RAM (1 hour at the default interval)
+#define TELEMETRY_QUEUE_INTERVAL       10000  // State sampling interval while offline (ms)
+#define TELEMETRY_DROP_OLDEST          1      // When full: 1 = drop the oldest record, 0 = drop the new one
+#define TELEMETRY_SPILL_TO_FS          1      // 1 = move the oldest records to LittleFS when RAM is full
+#define TELEMETRY_SPILL_FILE           "/telemetry.bin"
+#define TELEMETRY_SPILL_MAX_RECORDS    8640   // Spill file limit (24 hours at the default interval)
+#define TELEMETRY_REPLAY_RATE          5      // Records replayed per second after reconnecting
+#define MQTT_CONNECT_TIMEOUT           1      // Bound on the TCP connect and on the CONNACK wait, each (s): a connect attempt blocks loop() for up to twice this
+#define MQTT_RESOLVE_TIMEOUT           10000  // Give up on a broker name lookup after this long (ms), the lookup itself never blocks
+#define MQTT_BACKOFF_MIN               1000   // First retry delay after a failed connection (ms)
+#define MQTT_BACKOFF_MAX               60000  // Retry delay cap, doubled after each failure (ms)
 
 #endif // CONFIG_H
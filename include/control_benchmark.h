@@ -0,0 +1,150 @@
+#ifndef CONTROL_BENCHMARK_H
+#define CONTROL_BENCHMARK_H
+
+#include "arduino_compat.h"
+#include "config.h"
+#include "pid_controller.h"
+#include "pid_autotune.h"
+#include "boiler_simulator.h"
+
+// Closed-loop benchmark of the air intake control against BoilerSimulator.
+// Runs the same PID (AirIntakePID) and auto-tuner used by AirIntake with simulated
+// time, far faster than real time, and reports control quality per scenario.
+// Builds on the host too (test/test_control_benchmark, pio test -e native).
+class ControlBenchmark {
+public:
+    enum Scenario {
+        SCENARIO_COLD_START = 0,   // Firebox at ambient, controller starts at the target
+        SCENARIO_FUEL_LOAD,        // Fresh fuel load (+50% fuel) at steady state
+        SCENARIO_REFUEL,           // Fuel burns down to 30%, then a refuel back to 120%
+        SCENARIO_SETPOINT_STEP,    // Target raised by 15 Celsius at steady state
+        SCENARIO_AUTOTUNE,         // Relay auto-tuning from steady state
+        SCENARIO_COUNT
+    };
+
+    struct Result {
+        float iae;             // Integral of absolute error (Celsius*s)
+        float overshoot;       // Largest excursion above the target (Celsius)
+        float settlingTime;    // Time from the last disturbance until the error stays within
+                               // SIM_SETTLING_BAND (s, 0 = never left it, -1 = never settles)
+        float servoTravel;     // Total air intake movement (%)
+        float autotuneTime;    // Auto-tuning duration (s, -1 = not converged / not applicable)
+        float kp, ki, kd;      // Gains found by the auto-tuner (SCENARIO_AUTOTUNE only)
+    };
+
+    static const char* scenarioName(int scenario) {
+        switch (scenario) {
+            case SCENARIO_COLD_START: return "cold_start";
+            case SCENARIO_FUEL_LOAD: return "fuel_load";
+            case SCENARIO_REFUEL: return "refuel";
+            case SCENARIO_SETPOINT_STEP: return "setpoint_step";
+            case SCENARIO_AUTOTUNE: return "autotune";
+            default: return "unknown";
+        }
+    }
+
+    // Run one scenario with the given PID gains and target combustion temperature
+    static Result run(int scenario, float kp, float ki, float kd, float target,
+                      const BoilerSimulator::Params& params = BoilerSimulator::defaultParams()) {
+        const unsigned long stepMs = PID_SAMPLE_TIME;
+        const float stepSeconds = stepMs / 1000.0f;
+
+        BoilerSimulator plant(params, stepSeconds);
+        AirIntakePID pid(kp, ki, kd);
+        pid.setSampleTime(PID_SAMPLE_TIME);
+        pid.setOutputLimits(0, 100);
+
+        float air = 0;
+        unsigned long now = 0;
+
+        // Every scenario except the cold start begins at steady state on the target
+        if (scenario != SCENARIO_COLD_START) {
+            air = (int)((target - params.ambient) / params.gain);
+            for (int i = 0; i < 1000; i++) plant.step(air);
+            plant.reset(target, plant.getWaterTemperature());
+            for (int i = 0; i < 1000; i++) plant.step(air);
+        }
+        pid.setMode(AirIntakePID::AUTOMATIC, plant.getFireboxTemperature(), air);
+
+        Result result = {0, 0, -1, 0, -1, 0, 0, 0};
+
+        if (scenario == SCENARIO_AUTOTUNE) {
+            runAutoTune(plant, air, target, stepMs, result);
+            return result;
+        }
+
+        // Error is measured from the start of the cold start and from the disturbance one
+        // minute in for the others; settling from the last disturbance (the refuel halfway
+        // through the refuel scenario)
+        unsigned long duration = (unsigned long)SIM_SCENARIO_DURATION * 1000;
+        unsigned long measureFrom = scenario == SCENARIO_COLD_START ? 0 : DISTURBANCE_TIME;
+        unsigned long settleFrom = scenario == SCENARIO_REFUEL ? duration / 2 : measureFrom;
+        unsigned long lastOutside = settleFrom;
+
+        for (now = stepMs; now <= duration; now += stepMs) {
+            if (scenario != SCENARIO_COLD_START && now == DISTURBANCE_TIME) {
+                if (scenario == SCENARIO_FUEL_LOAD) plant.setFuel(1.5);
+                if (scenario == SCENARIO_REFUEL) plant.setFuel(0.3);
+                if (scenario == SCENARIO_SETPOINT_STEP) target += 15;
+            }
+            if (scenario == SCENARIO_REFUEL && now == duration / 2) {
+                plant.setFuel(1.2);
+            }
+
+            float temperature = plant.getFireboxTemperature();
+            if (pid.compute(temperature, target, now)) {
+                // The servo is positioned in whole percent, as in AirIntake
+                float newAir = (int)pid.getOutput();
+                result.servoTravel += fabs(newAir - air);
+                air = newAir;
+            }
+            plant.step(air);
+
+            if (now >= measureFrom) {
+                float error = target - temperature;
+                result.iae += fabs(error) * stepSeconds;
+                result.overshoot = max(result.overshoot, -error);
+                if (now >= settleFrom && fabs(error) > SIM_SETTLING_BAND) lastOutside = now;
+            }
+        }
+
+        // Settled only if the error stayed inside the band for the last quarter of the run
+        if (duration - lastOutside > duration / 4) {
+            result.settlingTime = (lastOutside - settleFrom) / 1000.0f;
+        }
+
+        return result;
+    }
+
+private:
+    static constexpr unsigned long DISTURBANCE_TIME = 60000;   // Scenario disturbance one minute in (ms)
+
+    static void runAutoTune(BoilerSimulator& plant, float air, float target, unsigned long stepMs, Result& result) {
+        PIDAutoTune::ControlType controlType = PID_CONTROL_TYPE == 0 ? PIDAutoTune::PID_TYPE :
+                                             (PID_CONTROL_TYPE == 1 ? PIDAutoTune::PI_TYPE :
+                                                                     PIDAutoTune::P_TYPE);
+        PIDAutoTune autoTune;
+        autoTune.init(target, air, PID_OUTPUT_STEP, PID_NOISE_BAND, controlType);
+        autoTune.start(0);
+
+        for (unsigned long now = stepMs; now <= PID_AUTOTUNE_TIMEOUT + stepMs; now += stepMs) {
+            bool finished = autoTune.compute(plant.getFireboxTemperature(), now);
+            float newAir = (int)autoTune.getOutput();
+            result.servoTravel += fabs(newAir - air);
+            air = newAir;
+            plant.step(air);
+
+            if (finished) {
+                if (autoTune.getState() == PIDAutoTune::STATE_DONE) {
+                    result.autotuneTime = now / 1000.0f;
+                    result.kp = autoTune.getKp();
+                    result.ki = autoTune.getKi();
+                    result.kd = autoTune.getKd();
+                }
+                break;
+            }
+        }
+    }
+};
+
+#endif // CONTROL_BENCHMARK_H
@@ -6,6 +6,7 @@
 #include <SPI.h>
 #include <WiFi.h>
 #include "config.h"
+#include "temperature_sensors.h"
 
 class Display {
 public:
@@ -44,8 +45,8 @@ public:
     }
 
     // Update method - to be called regularly from the main loop
-    void update(float boilerWaterTemp, float heatingTemp, float burningTemp, float ambientTemp,
-                bool boilerPump, bool heatingPump, bool fans, float targetBurningTemp, int airIntakePosition) {
+    void update(const SensorSnapshot& sensors, bool boilerPump, bool heatingPump, bool fans,
+                float targetBurningTemp, int airIntakePosition) {
 
         // Check if it's time to toggle screens
         unsigned long currentMillis = millis();
@@ -58,8 +59,7 @@ public:
         // Display the current screen
         u8g2.clearBuffer();
         if (currentScreen == SCREEN_MAIN) {
-            showMainScreen(boilerWaterTemp, heatingTemp, burningTemp, ambientTemp,
-                          boilerPump, heatingPump, fans, targetBurningTemp, airIntakePosition);
+            showMainScreen(sensors, boilerPump, heatingPump, fans, targetBurningTemp, airIntakePosition);
         } else {
             showNetworkInfo();
         }
@@ -149,8 +149,8 @@ public:
 
 private:
     // Method to show the main information screen
-    void showMainScreen(float boilerWaterTemp, float heatingTemp, float burningTemp, float ambientTemp,
-                      bool boilerPump, bool heatingPump, bool fans, float targetBurningTemp, int airIntakePosition) {
+    void showMainScreen(const SensorSnapshot& sensors, bool boilerPump, bool heatingPump, bool fans,
+                      float targetBurningTemp, int airIntakePosition) {
         u8g2.clearBuffer();
 
         // Title
@@ -163,16 +163,16 @@ private:
 
         // Temperatures
         char buffer[32];
-        sprintf(buffer, "Water: %.1fC", boilerWaterTemp);
+        sprintf(buffer, "Water: %.1fC", sensors.boilerWater());
         u8g2.drawStr(0, 16, buffer);
 
-        sprintf(buffer, "Heat: %.1fC", heatingTemp);
+        sprintf(buffer, "Heat: %.1fC", sensors.heating());
         u8g2.drawStr(0, 26, buffer);
 
-        sprintf(buffer, "Burn: %.1fC", burningTemp);
+        sprintf(buffer, "Burn: %.1fC", sensors.burning());
         u8g2.drawStr(0, 36, buffer);
 
-        sprintf(buffer, "Amb: %.1fC", ambientTemp);
+        sprintf(buffer, "Amb: %.1fC", sensors.ambient());
         u8g2.drawStr(0, 46, buffer);
 
         // Status
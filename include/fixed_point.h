@@ -0,0 +1,78 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include "arduino_compat.h"
+
+// Signed Q16.16 fixed point number (range about +/-32768, resolution 1/65536).
+// Used by the PID controller so the ESP32-S2, which has no FPU, can run
+// the control law with integer arithmetic only.
+class Fixed16 {
+public:
+    constexpr Fixed16() : raw(0) {}
+    Fixed16(float value) : raw(fromFloat(value)) {}
+    Fixed16(int value) : raw(saturate((int64_t)value * ONE)) {}
+
+    static constexpr Fixed16 fromRaw(int32_t value) {
+        return Fixed16(value, true);
+    }
+
+    int32_t getRaw() const {
+        return raw;
+    }
+
+    float toFloat() const {
+        return (float)raw / ONE;
+    }
+
+    Fixed16 operator+(Fixed16 other) const { return fromRaw(saturate((int64_t)raw + other.raw)); }
+    Fixed16 operator-(Fixed16 other) const { return fromRaw(saturate((int64_t)raw - other.raw)); }
+    Fixed16 operator-() const { return fromRaw(raw == INT32_MIN ? INT32_MAX : -raw); }
+    Fixed16 operator*(Fixed16 other) const { return fromRaw(saturate(((int64_t)raw * other.raw) >> 16)); }
+    Fixed16 operator/(Fixed16 other) const {
+        if (other.raw == 0) return fromRaw(raw >= 0 ? INT32_MAX : INT32_MIN);
+        return fromRaw(saturate(((int64_t)raw << 16) / other.raw));
+    }
+
+    Fixed16& operator+=(Fixed16 other) { *this = *this + other; return *this; }
+    Fixed16& operator-=(Fixed16 other) { *this = *this - other; return *this; }
+
+    bool operator<(Fixed16 other) const { return raw < other.raw; }
+    bool operator>(Fixed16 other) const { return raw > other.raw; }
+    bool operator<=(Fixed16 other) const { return raw <= other.raw; }
+    bool operator>=(Fixed16 other) const { return raw >= other.raw; }
+    bool operator==(Fixed16 other) const { return raw == other.raw; }
+    bool operator!=(Fixed16 other) const { return raw != other.raw; }
+
+private:
+    static constexpr int32_t ONE = 65536;
+
+    constexpr Fixed16(int32_t value, bool) : raw(value) {}
+
+    // Rounded to nearest, saturated at the range limits. NaN becomes 0
+    static int32_t fromFloat(float value) {
+        if (isnan(value)) return 0;
+        float scaled = value * ONE;
+        if (scaled >= 2147483648.0f) return INT32_MAX;
+        if (scaled <= -2147483648.0f) return INT32_MIN;
+        return (int32_t)(scaled >= 0 ? scaled + 0.5f : scaled - 0.5f);
+    }
+
+    static int32_t saturate(int64_t value) {
+        if (value > INT32_MAX) return INT32_MAX;
+        if (value < INT32_MIN) return INT32_MIN;
+        return (int32_t)value;
+    }
+
+    int32_t raw;
+};
+
+// Conversion back to float for both numeric types used by the controllers
+inline float toFloat(float value) {
+    return value;
+}
+
+inline float toFloat(Fixed16 value) {
+    return value.toFloat();
+}
+
+#endif // FIXED_POINT_H
@@ -4,252 +4,858 @@
 #include <Arduino.h>
 #include <PubSubClient.h>
 #include <WiFi.h>
-#include <ArduinoJson.h>
+#include <lwip/dns.h>
+#include <atomic>
 #include "config.h"
+#include "temperature_sensors.h"
+#include "telemetry_queue.h"
+#include "pid_autotune.h"
+#include "system_state.h"
+#include "command_queue.h"
+#include "json_writer.h"
+#include "log_buffer.h"
 
 class HomeAssistant {
 public:
-    HomeAssistant(WiFiClient& wifiClient) : mqttClient(wifiClient), mqttConnected(false) {}
+    // Connection state machine, advanced one step per loop() call
+    enum MqttState {
+        MQTT_OFFLINE,       // No WiFi
+        MQTT_BACKOFF,       // Waiting before the next attempt
+        MQTT_RESOLVING,     // Looking up the broker address
+        MQTT_CONNECTING,    // TCP + MQTT CONNECT
+        MQTT_SUBSCRIBING,   // One control topic per step
+        MQTT_DISCOVERY,     // One Home Assistant discovery entity per step
+        MQTT_READY
+    };
+
+    struct ConnectionStats {
+        uint32_t attempts;        // Connection attempts
+        uint32_t connects;        // Successful connections
+        uint32_t failures;        // Failed attempts (resolve or connect)
+        uint32_t timeToConnect;   // Last time from losing the connection to ready (ms)
+        uint32_t blockedTotal;    // Time spent inside blocking network calls (ms)
+        uint32_t blockedMax;      // Longest single blocking call (ms)
+        uint32_t backoff;         // Current retry delay (ms)
+    };
+
+    // Inbound command handling. A command may have arrived at any point since the previous
+    // service call, so latency is measured from that call to the end of the callback
+    struct CommandStats {
+        uint32_t commands;        // Commands handled
+        uint32_t lastLatency;     // Worst case arrival -> applied for the last command (us)
+        uint32_t maxLatency;      // (us)
+        uint32_t maxServiceGap;   // Longest interval between two service calls while connected (ms)
+    };
+
+    HomeAssistant(WiFiClient& wifiClient) : wifiClient(wifiClient), mqttClient(wifiClient), state(MQTT_OFFLINE),
+        backoff(MQTT_BACKOFF_MIN), retryAt(0), disconnectedSince(0), step(0), haveBrokerIp(false) {
+        stats = {0, 0, 0, 0, 0, 0, 0};
+        commandStats = {0, 0, 0, 0};
+    }
 
     void begin() {
-        // Only initialize MQTT if there is WiFi connection
-        if (WiFi.status() == WL_CONNECTED) {
-            mqttClient.setServer(MQTT_SERVER, MQTT_PORT);
-            mqttConnected = connect();
-
-            if (mqttConnected) {
-                publishDiscovery();
-                Serial.println("MQTT and Home Assistant integration completed");
+        // Bound the blocking parts of a connection attempt (TCP connect and CONNACK wait)
+        wifiClient.setTimeout(MQTT_CONNECT_TIMEOUT);
+        mqttClient.setSocketTimeout(MQTT_CONNECT_TIMEOUT);
+        disconnectedSince = millis();
+
+        // Needs LittleFS mounted
+        telemetryQueue.begin();
+    }
+
+    // Advance the connection state machine, at most one network operation per call.
+    // The broker name is resolved in the background (lwIP DNS, polled here); the one call
+    // that still blocks is the connect, for the TCP handshake plus the CONNACK wait, each
+    // bounded by MQTT_CONNECT_TIMEOUT (so up to twice that). Subscribe and publish calls
+    // only wait for the socket to take the bytes
+    void loop() {
+        unsigned long now = millis();
+
+        if (WiFi.status() != WL_CONNECTED) {
+            if (state != MQTT_OFFLINE) {
+                setDisconnected(now);
+                state = MQTT_OFFLINE;
+                resolving = false;
             }
-        } else {
-            mqttConnected = false;
-            Serial.println("No WiFi connection, MQTT disabled");
+            return;
         }
-    }
 
-    void update(float boilerWaterTemp, float heatingTemp, float burningTemp, float ambientTemp,
-                bool boilerPump, bool heatingPump, bool fans, bool otherRelay,
-                float targetBurningTemp, int airIntakePosition) {
+        switch (state) {
+            case MQTT_OFFLINE:
+                // WiFi is back, connect right away
+                backoff = MQTT_BACKOFF_MIN;
+                state = haveBrokerIp ? MQTT_CONNECTING : MQTT_RESOLVING;
+                break;
 
-        // If there is no WiFi or MQTT, exit immediately
-        if (WiFi.status() != WL_CONNECTED || !mqttConnected) {
-            // Try to reconnect to WiFi and MQTT periodically
-            static unsigned long lastReconnectAttempt = 0;
-            unsigned long now = millis();
+            case MQTT_BACKOFF:
+                if ((long)(now - retryAt) >= 0) {
+                    state = haveBrokerIp ? MQTT_CONNECTING : MQTT_RESOLVING;
+                }
+                break;
 
-            // Try to reconnect every 30 seconds
-            if (now - lastReconnectAttempt > 30000) {
-                lastReconnectAttempt = now;
+            case MQTT_RESOLVING: {
+                if (!resolving) {
+                    stats.attempts++;
+                    startResolve(now);
+                }
+                uint8_t result = dnsResult.load(std::memory_order_acquire);
+                if (result == DNS_PENDING && now - resolveStarted < MQTT_RESOLVE_TIMEOUT) {
+                    break;  // Still waiting for the DNS server
+                }
+                resolving = false;
+
+                if (result == DNS_FOUND) {
+                    brokerIp = IPAddress(dnsAddress.load(std::memory_order_relaxed));
+                    haveBrokerIp = true;
+                    mqttClient.setServer(brokerIp, MQTT_PORT);
+                    state = MQTT_CONNECTING;
+                } else {
+                    LOG_WARN(MSG_MQTT_RESOLVE_FAILED);
+                    scheduleRetry(now);
+                }
+                break;
+            }
 
-                // If WiFi is disconnected, we don't try MQTT
-                if (WiFi.status() != WL_CONNECTED) {
-                    return;
+            case MQTT_CONNECTING: {
+                stats.attempts++;
+                LOG_DEBUG(MSG_MQTT_CONNECTING);
+                unsigned long start = micros();
+                bool connected = mqttClient.connect(MQTT_CLIENT_ID, MQTT_USER, MQTT_PASSWORD);
+                addBlocked(start);
+
+                if (connected) {
+                    LOG_DEBUG(MSG_MQTT_SESSION);
+                    step = 0;
+                    state = MQTT_SUBSCRIBING;
+                } else {
+                    LOG_WARN(MSG_MQTT_CONNECT_FAILED, mqttClient.state());
+                    // Resolve again next time in case the broker moved
+                    haveBrokerIp = false;
+                    scheduleRetry(now);
                 }
+                break;
+            }
 
-                // Try to reconnect MQTT
-                mqttConnected = connect();
-                if (mqttConnected) {
-                    Serial.println("Reconnected to MQTT");
-                    publishDiscovery(); // Republish on reconnect
+            case MQTT_SUBSCRIBING:
+                if (!checkConnection(now)) break;
+                if (step < SUBSCRIPTION_COUNT) {
+                    char topic[64];
+                    snprintf(topic, sizeof(topic), MQTT_BASE_TOPIC "%s", subscription(step));
+                    unsigned long start = micros();
+                    mqttClient.subscribe(topic);
+                    addBlocked(start);
+                    step++;
+                } else {
+                    step = 0;
+                    state = MQTT_DISCOVERY;
+                }
+                break;
+
+            case MQTT_DISCOVERY:
+                if (!checkConnection(now)) break;
+                if (step < DISCOVERY_COUNT) {
+                    unsigned long start = micros();
+                    bool published = publishDiscoveryEntity(step);
+                    addBlocked(start);
+                    if (published) {
+                        step++;
+                    } else {
+                        // Home Assistant would miss the entity until the next connection:
+                        // start over after the backoff, discovery included
+                        LOG_WARN(MSG_MQTT_DISCOVERY_FAILED, discoveryEntity(step).id);
+                        mqttClient.disconnect();
+                        setDisconnected(now);
+                        stats.failures++;
+                        scheduleRetry(now);
+                    }
+                    break;
                 }
+                // All entities published
+                state = MQTT_READY;
+                backoff = MQTT_BACKOFF_MIN;
+                stats.connects++;
+                stats.timeToConnect = now - disconnectedSince;
+                LOG_DEBUG(MSG_MQTT_READY);
+                break;
+
+            case MQTT_READY:
+                if (checkConnection(now)) {
+                    service();
+                }
+                break;
+        }
+    }
+
+    // Publish the state if something changed. Meant to be called often (MQTT_CHECK_INTERVAL):
+    // switches, faults and the target go out immediately, temperatures and the air intake
+    // when they move past their deadband (at most every MQTT_MIN_PUBLISH_INTERVAL), and
+    // everything at least every MQTT_MAX_AGE. Without a broker the state is queued every
+    // TELEMETRY_QUEUE_INTERVAL and replayed after reconnecting
+    void update(const SystemState& boiler) {
+        // Current value of every field, in field table order
+        float current[FIELD_COUNT];
+        collect(boiler, current);
+
+        unsigned long now = millis();
+
+        // If there is no WiFi or MQTT, keep the state for later; loop() takes care of reconnecting
+        if (state != MQTT_READY) {
+            publishedOnce = false;
+            if (now - lastQueued >= TELEMETRY_QUEUE_INTERVAL) {
+                lastQueued = now;
+                telemetryQueue.push(toRecord(current, now));
             }
             return;
         }
 
-        // Comprobar conexión MQTT
-        if (!mqttClient.connected()) {
-            mqttConnected = connect();
-            if (!mqttConnected) {
-                return; // Si no podemos conectar, salimos
+        // Drain the backlog at a limited rate, one record per call
+        if (!telemetryQueue.isEmpty() && now - lastReplay >= 1000 / TELEMETRY_REPLAY_RATE) {
+            lastReplay = now;
+            replayRecord(now);
+        }
+
+        // Decide what needs publishing
+        bool heartbeat = !publishedOnce || now - lastFullPublish >= MQTT_MAX_AGE;
+        bool analogDue = now - lastAnalogPublish >= MQTT_MIN_PUBLISH_INTERVAL;
+        bool changed[FIELD_COUNT];
+        bool anyChanged = false;
+        bool analogChanged = false;
+
+        for (int i = 0; i < FIELD_COUNT; i++) {
+            float deadband = field(i).deadband;
+            if (heartbeat) {
+                changed[i] = true;
+            } else if (isnan(current[i]) || isnan(published[i])) {
+                changed[i] = isnan(current[i]) != isnan(published[i]);
+            } else if (deadband > 0) {
+                changed[i] = analogDue && fabs(current[i] - published[i]) >= deadband;
+            } else {
+                changed[i] = current[i] != published[i];
             }
+            anyChanged = anyChanged || changed[i];
+            analogChanged = analogChanged || (changed[i] && deadband > 0);
         }
 
-        // Crear JSON para los datos de sensores
-        StaticJsonDocument<512> doc;
-        doc["boiler_water_temp"] = boilerWaterTemp;
-        doc["heating_temp"] = heatingTemp;
-        doc["burning_temp"] = burningTemp;
-        doc["ambient_temp"] = ambientTemp;
-        doc["boiler_pump"] = boilerPump ? "ON" : "OFF";
-        doc["heating_pump"] = heatingPump ? "ON" : "OFF";
-        doc["fans"] = fans ? "ON" : "OFF";
-        doc["other_relay"] = otherRelay ? "ON" : "OFF";
-        doc["target_burning_temp"] = targetBurningTemp;
-        doc["air_intake"] = map(airIntakePosition, 0, 180, 0, 100); // Convertir a porcentaje
+        if (!anyChanged) {
+            return;
+        }
 
-        char buffer[512];
-        serializeJson(doc, buffer);
+        // A field only counts as published once the client accepted it; the others stay
+        // changed and go out again on the next call
+#if MQTT_PER_FIELD_TOPICS
+        // Only the fields that changed, each on its own retained topic
+        bool allSent = true;
+        for (int i = 0; i < FIELD_COUNT; i++) {
+            if (!changed[i]) continue;
+            char topic[64];
+            char value[16];
+            fieldTopic(i, topic, sizeof(topic));
+            formatField(i, current[i], value, sizeof(value));
+            if (publishState(topic, value)) {
+                published[i] = current[i];
+            } else {
+                allSent = false;
+            }
+        }
+        heartbeat = heartbeat && allSent;
+#else
+        // Publicar el estado completo, escrito directamente en el cliente MQTT
+        bool sent = publishJson(MQTT_BASE_TOPIC "/state", true, [&](JsonWriter& json) {
+            writeState(json, current, false);
+        });
+        if (!sent) {
+            return;
+        }
+        for (int i = 0; i < FIELD_COUNT; i++) {
+            published[i] = current[i];
+        }
+        heartbeat = true;  // The whole state went out
+#endif
 
-        // Publicar estado
-        mqttClient.publish(String(MQTT_BASE_TOPIC + String("/state")).c_str(), buffer, true);
+        if (heartbeat) {
+            lastFullPublish = now;
+            publishedOnce = true;
+        }
+        if (analogChanged || heartbeat) {
+            lastAnalogPublish = now;
+        }
+    }
 
-        // Manejar mensajes entrantes
-        mqttClient.loop();
+    // The full state message exactly as update() publishes it on <base>/state
+    static void writeStateMessage(Print& out, const SystemState& boiler) {
+        float values[FIELD_COUNT];
+        collect(boiler, values);
+        JsonWriter json(out);
+        json.beginObject();
+        writeState(json, values, false);
+        json.endObject();
     }
 
-    void setCallback(MQTT_CALLBACK_SIGNATURE) {
-        // Solo establecer el callback si hay conexión MQTT
-        if (mqttConnected) {
-            mqttClient.setCallback(callback);
+    // Broker traffic generated by update()
+    struct TelemetryStats {
+        uint32_t messages;    // State messages published
+        uint32_t bytes;       // Payload bytes published
+    };
+
+    TelemetryStats getTelemetryStats() const {
+        return telemetryStats;
+    }
+
+    // Outcome of a command received on a /set/ topic, on <base>/command_result
+    void publishCommandResult(const CommandResult& result) {
+        if (state != MQTT_READY) {
+            return;
         }
+        publishJson(MQTT_BASE_TOPIC "/command_result", false, [&](JsonWriter& json) {
+            json.add("id", result.id);
+            json.add("command", Command::typeName(result.type));
+            json.add("status", CommandResult::statusName(result.status));
+            if (result.reason) {
+                json.add("reason", result.reason);
+            }
+            json.add("latency", result.latency);
+        });
+    }
+
+    TelemetryQueue::Stats getQueueStats() const {
+        return telemetryQueue.getStats();
+    }
+
+    void setCallback(MQTT_CALLBACK_SIGNATURE) {
+        // Se guarda aunque aún no haya conexión; se usa en cuanto conecte
+        commandCallback = callback;
+        mqttClient.setCallback([this](char* topic, uint8_t* payload, unsigned int length) {
+            handleCommand(topic, payload, length);
+        });
     }
 
     bool isMqttConnected() const {
-        return mqttConnected;
+        return state == MQTT_READY;
     }
 
-private:
-    bool connect() {
-        // Check if WiFi is connected
-        if (WiFi.status() != WL_CONNECTED) {
-            Serial.println("No WiFi connection, cannot connect to MQTT");
-            return false;
+    MqttState getState() const {
+        return state;
+    }
+
+    ConnectionStats getStats() const {
+        return stats;
+    }
+
+    CommandStats getCommandStats() const {
+        return commandStats;
+    }
+
+    static const char* stateName(MqttState state) {
+        switch (state) {
+            case MQTT_OFFLINE: return "offline";
+            case MQTT_BACKOFF: return "backoff";
+            case MQTT_RESOLVING: return "resolving";
+            case MQTT_CONNECTING: return "connecting";
+            case MQTT_SUBSCRIBING: return "subscribing";
+            case MQTT_DISCOVERY: return "discovery";
+            case MQTT_READY: return "ready";
+            default: return "unknown";
         }
+    }
 
-        // Try to connect to MQTT server
-        Serial.print("Connecting to MQTT...");
 
-        int attempts = 0;
-        const int maxAttempts = 3; // Limit attempts to avoid blocking
+private:
+    // Published state fields. Health holds one entry per sensor channel
+    enum FieldType {
+        FIELD_TEMPERATURE,
+        FIELD_INTEGER,
+        FIELD_GAIN,
+        FIELD_SWITCH,
+        FIELD_AUTOTUNE_STATE,
+        FIELD_HEALTH
+    };
+
+    enum FieldId {
+        FIELD_BOILER_WATER_TEMP = 0,
+        FIELD_HEATING_TEMP,
+        FIELD_BURNING_TEMP,
+        FIELD_AMBIENT_TEMP,
+        FIELD_BOILER_PUMP,
+        FIELD_HEATING_PUMP,
+        FIELD_FANS,
+        FIELD_OTHER_RELAY,
+        FIELD_KILLSWITCH,
+        FIELD_SENSOR_FAULT,
+        FIELD_TARGET_BURNING_TEMP,
+        FIELD_AIR_INTAKE,
+        FIELD_SERVO_MIN,
+        FIELD_SERVO_MAX,
+        FIELD_AUTOTUNE,
+        FIELD_PID_KP,
+        FIELD_PID_KI,
+        FIELD_PID_KD,
+        FIELD_HEALTH_FIRST,
+        FIELD_COUNT = FIELD_HEALTH_FIRST + SENSOR_CHANNEL_COUNT
+    };
+
+    struct Field {
+        const char* name;
+        FieldType type;
+        float deadband;   // 0 = published on any change
+        bool queued;      // Kept in TelemetryRecord while offline
+    };
+
+    static const Field& field(int index) {
+        static const Field fields[FIELD_COUNT] = {
+            {"boiler_water_temp", FIELD_TEMPERATURE, MQTT_TEMP_DEADBAND, true},
+            {"heating_temp", FIELD_TEMPERATURE, MQTT_TEMP_DEADBAND, true},
+            {"burning_temp", FIELD_TEMPERATURE, MQTT_TEMP_DEADBAND, true},
+            {"ambient_temp", FIELD_TEMPERATURE, MQTT_TEMP_DEADBAND, true},
+            {"boiler_pump", FIELD_SWITCH, 0, true},
+            {"heating_pump", FIELD_SWITCH, 0, true},
+            {"fans", FIELD_SWITCH, 0, true},
+            {"other_relay", FIELD_SWITCH, 0, true},
+            {"killswitch", FIELD_SWITCH, 0, true},
+            {"sensor_fault", FIELD_SWITCH, 0, true},
+            {"target_burning_temp", FIELD_TEMPERATURE, 0, true},
+            {"air_intake", FIELD_INTEGER, MQTT_AIR_DEADBAND, true},
+            {"servo_min", FIELD_INTEGER, 0, false},
+            {"servo_max", FIELD_INTEGER, 0, false},
+            {"autotune", FIELD_AUTOTUNE_STATE, 0, false},
+            {"pid_kp", FIELD_GAIN, 0, false},
+            {"pid_ki", FIELD_GAIN, 0, false},
+            {"pid_kd", FIELD_GAIN, 0, false},
+            {"boiler_water", FIELD_HEALTH, 0, true},
+            {"heating", FIELD_HEALTH, 0, true},
+            {"burning", FIELD_HEALTH, 0, true},
+            {"ambient", FIELD_HEALTH, 0, true}
+        };
+        return fields[index];
+    }
 
-        while (!mqttClient.connected() && attempts < maxAttempts) {
-            if (mqttClient.connect(MQTT_CLIENT_ID, MQTT_USER, MQTT_PASSWORD)) {
-                Serial.println("connected");
+    // Payload of a field on its own topic
+    static void formatField(int index, float value, char* out, size_t size) {
+        switch (field(index).type) {
+            case FIELD_SWITCH:
+                snprintf(out, size, "%s", value ? "ON" : "OFF");
+                break;
+            case FIELD_HEALTH:
+                snprintf(out, size, "%s", SensorHealth::stateName((SensorHealth::State)value));
+                break;
+            case FIELD_AUTOTUNE_STATE:
+                snprintf(out, size, "%s", PIDAutoTune::stateName((PIDAutoTune::State)value));
+                break;
+            case FIELD_INTEGER:
+                snprintf(out, size, "%d", (int)value);
+                break;
+            case FIELD_GAIN:
+                snprintf(out, size, "%.4f", value);
+                break;
+            default:
+                snprintf(out, size, "%.2f", value);
+                break;
+        }
+    }
 
-                // Subscribe to control topics
-                mqttClient.subscribe(String(MQTT_BASE_TOPIC + String("/set/target_burning_temp")).c_str());
-                mqttClient.subscribe(String(MQTT_BASE_TOPIC + String("/set/boiler_pump")).c_str());
-                mqttClient.subscribe(String(MQTT_BASE_TOPIC + String("/set/heating_pump")).c_str());
-                mqttClient.subscribe(String(MQTT_BASE_TOPIC + String("/set/fans")).c_str());
-                mqttClient.subscribe(String(MQTT_BASE_TOPIC + String("/set/other_relay")).c_str());
+    // Value of every field of a state, in field table order
+    static void collect(const SystemState& boiler, float* values) {
+        const SensorSnapshot& sensors = boiler.sensors;
+
+        values[FIELD_BOILER_WATER_TEMP] = sensors.boilerWater();
+        values[FIELD_HEATING_TEMP] = sensors.heating();
+        values[FIELD_BURNING_TEMP] = sensors.burning();
+        values[FIELD_AMBIENT_TEMP] = sensors.ambient();
+        values[FIELD_BOILER_PUMP] = boiler.boilerPump;
+        values[FIELD_HEATING_PUMP] = boiler.heatingPump;
+        values[FIELD_FANS] = boiler.fans;
+        values[FIELD_OTHER_RELAY] = boiler.otherRelay;
+        values[FIELD_KILLSWITCH] = boiler.killSwitch;
+        values[FIELD_TARGET_BURNING_TEMP] = boiler.targetBurningTemp;
+        values[FIELD_AIR_INTAKE] = boiler.airIntake;
+        values[FIELD_SERVO_MIN] = boiler.servoMin;
+        values[FIELD_SERVO_MAX] = boiler.servoMax;
+        values[FIELD_AUTOTUNE] = boiler.autoTune.state;
+        values[FIELD_PID_KP] = boiler.kp;
+        values[FIELD_PID_KI] = boiler.ki;
+        values[FIELD_PID_KD] = boiler.kd;
+
+        bool sensorFault = false;
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            values[FIELD_HEALTH_FIRST + i] = sensors.health[i];
+            sensorFault = sensorFault || sensors.isFaulted(i);
+        }
+        values[FIELD_SENSOR_FAULT] = sensorFault;
+    }
 
-                return true;
+    // Members of the full state, health grouped under sensor_health. queuedOnly leaves out
+    // the fields a TelemetryRecord does not keep
+    static void writeState(JsonWriter& json, const float* values, bool queuedOnly) {
+        for (int i = 0; i < FIELD_HEALTH_FIRST; i++) {
+            if (queuedOnly && !field(i).queued) {
+                continue;
+            }
+            if (field(i).type == FIELD_SWITCH) {
+                json.add(field(i).name, values[i] ? "ON" : "OFF");
+            } else if (field(i).type == FIELD_AUTOTUNE_STATE) {
+                json.add(field(i).name, PIDAutoTune::stateName((PIDAutoTune::State)values[i]));
             } else {
-                Serial.print("failed, rc=");
-                Serial.print(mqttClient.state());
-                Serial.println(" Trying again...");
-                delay(1000);
-                attempts++;
+                json.add(field(i).name, values[i]);
             }
         }
 
-        if (attempts >= maxAttempts) {
-            Serial.println("Could not connect to MQTT after several attempts - System will continue without MQTT");
+        // Estado de salud de cada sonda
+        json.beginObject("sensor_health");
+        for (int i = FIELD_HEALTH_FIRST; i < FIELD_COUNT; i++) {
+            json.add(field(i).name, SensorHealth::stateName((SensorHealth::State)values[i]));
         }
+        json.endObject();
+    }
 
-        return false;
+    static TelemetryRecord toRecord(const float* values, unsigned long now) {
+        TelemetryRecord record;
+        record.timestamp = now;
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            float value = values[FIELD_BOILER_WATER_TEMP + i];
+            record.temperature[i] = isnan(value) ? TelemetryRecord::TEMPERATURE_NONE : (int16_t)lroundf(value * 10);
+        }
+        record.target = (int16_t)lroundf(values[FIELD_TARGET_BURNING_TEMP] * 10);
+        record.airIntake = (uint8_t)values[FIELD_AIR_INTAKE];
+        record.switches = 0;
+        for (int i = FIELD_BOILER_PUMP; i <= FIELD_SENSOR_FAULT; i++) {
+            if (values[i]) record.switches |= 1 << (i - FIELD_BOILER_PUMP);
+        }
+        record.health = 0;
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            record.health |= ((uint16_t)values[FIELD_HEALTH_FIRST + i] & 0x0F) << (4 * i);
+        }
+        return record;
     }
 
-    void publishDiscovery() {
-        // Publicar información de descubrimiento para Home Assistant
-        // Esto permite que HA detecte automáticamente los sensores y controles
+    static void fromRecord(const TelemetryRecord& record, float* values) {
+        for (int i = 0; i < FIELD_COUNT; i++) {
+            values[i] = NAN;
+        }
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            int16_t value = record.temperature[i];
+            values[FIELD_BOILER_WATER_TEMP + i] = value == TelemetryRecord::TEMPERATURE_NONE ? NAN : value / 10.0f;
+        }
+        values[FIELD_TARGET_BURNING_TEMP] = record.target / 10.0f;
+        values[FIELD_AIR_INTAKE] = record.airIntake;
+        for (int i = FIELD_BOILER_PUMP; i <= FIELD_SENSOR_FAULT; i++) {
+            values[i] = (record.switches >> (i - FIELD_BOILER_PUMP)) & 1;
+        }
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            values[FIELD_HEALTH_FIRST + i] = (record.health >> (4 * i)) & 0x0F;
+        }
+    }
 
-        // Temperatura del agua de la caldera
-        publishSensor("boiler_water_temp", "Temperatura Agua Caldera", "temperature", "°C");
+    // Publish the oldest queued record with its original time (uptime) and age. It only
+    // leaves the queue once sent; otherwise the next replay tries it again
+    void replayRecord(unsigned long now) {
+        TelemetryRecord record;
+        if (!telemetryQueue.peek(record)) {
+            return;
+        }
 
-        // Temperatura de calefacción
-        publishSensor("heating_temp", "Temperatura Calefacción", "temperature", "°C");
+        float values[FIELD_COUNT];
+        fromRecord(record, values);
 
-        // Temperatura de combustión
-        publishSensor("burning_temp", "Temperatura Combustión", "temperature", "°C");
+        bool sent = publishJson(MQTT_BASE_TOPIC "/replay", false, [&](JsonWriter& json) {
+            json.add("ts", (unsigned long)record.timestamp);
+            json.add("age", now - record.timestamp);
+            writeState(json, values, true);
+        });
+        if (sent) {
+            telemetryQueue.pop();
+        }
+    }
 
-        // Temperatura ambiente
-        publishSensor("ambient_temp", "Temperatura Ambiente", "temperature", "°C");
+    // Per-field state topic (health fields live under sensor_health/)
+    static void fieldTopic(int index, char* out, size_t size) {
+        snprintf(out, size, MQTT_BASE_TOPIC "/state/%s%s",
+                 field(index).type == FIELD_HEALTH ? "sensor_health/" : "", field(index).name);
+    }
 
-        // Bomba de la caldera
-        publishBinarySensor("boiler_pump", "Bomba Caldera", "connectivity");
+    // Returns whether the message was sent; only then is it counted
+    bool publishState(const char* topic, const char* payload, bool retain = true) {
+        if (!mqttClient.publish(topic, payload, retain)) {
+            return false;
+        }
+        telemetryStats.messages++;
+        telemetryStats.bytes += strlen(payload);
+        return true;
+    }
 
-        // Bomba de calefacción
-        publishBinarySensor("heating_pump", "Bomba Calefacción", "connectivity");
+    // Publish a JSON object whose members are written by writeMembers(JsonWriter&).
+    // Returns whether it was sent; only then is it counted
+    template <typename TWriter>
+    bool publishJson(const char* topic, bool retain, TWriter writeMembers) {
+        size_t length;
+        bool sent = publishStream(topic, retain, [&](Print& out) {
+            JsonWriter json(out);
+            json.beginObject();
+            writeMembers(json);
+            json.endObject();
+        }, &length);
+        if (sent) {
+            telemetryStats.messages++;
+            telemetryStats.bytes += length;
+        }
+        return sent;
+    }
 
-        // Ventiladores
-        publishBinarySensor("fans", "Ventiladores", "connectivity");
+    // Stream a payload written by write(Print&) straight into the client: one pass to
+    // measure it, one to send it in MQTT_STREAM_CHUNK byte pieces. No payload buffer,
+    // document or String is built. Returns whether the client sent it, and its length
+    // in *length
+    template <typename TWriter>
+    bool publishStream(const char* topic, bool retain, TWriter write, size_t* length = nullptr) {
+        PrintCounter counter;
+        write(counter);
+        if (length) {
+            *length = counter.count;
+        }
 
-        // Otro relé
-        publishBinarySensor("other_relay", "Otro Dispositivo", "connectivity");
+        if (!mqttClient.beginPublish(topic, counter.count, retain)) {
+            return false;
+        }
+        ChunkedPrint<MQTT_STREAM_CHUNK> out(mqttClient);
+        write(out);
+        out.flush();
+        return mqttClient.endPublish();
+    }
 
-        // Temperatura objetivo de combustión (control)
-        publishNumberControl("target_burning_temp", "Temperatura Objetivo", "temperature", "°C", 60, 100, 1);
+    // Read inbound messages and keep the connection alive
+    void service() {
+        uint32_t now = micros();
+        if (serviceRunning) {
+            commandStats.maxServiceGap = max(commandStats.maxServiceGap, (now - lastService + 500) / 1000);
+        }
+        previousService = serviceRunning ? lastService : now;
+        lastService = now;
+        serviceRunning = true;
 
-        // Posición de entrada de aire
-        publishSensor("air_intake", "Entrada de Aire", "power_factor", "%");
+        mqttClient.loop();
     }
 
-    void publishSensor(const String& id, const String& name, const String& deviceClass, const String& unitOfMeasurement) {
-        StaticJsonDocument<512> doc;
-
-        doc["name"] = name;
-        doc["state_topic"] = String(MQTT_BASE_TOPIC) + "/state";
-        doc["value_template"] = "{{ value_json." + id + " }}";
-        doc["unique_id"] = String("lumber_boiler_") + id;
-        doc["device_class"] = deviceClass;
-        doc["unit_of_measurement"] = unitOfMeasurement;
+    void handleCommand(char* topic, uint8_t* payload, unsigned int length) {
+        if (commandCallback) {
+            commandCallback(topic, payload, length);
+        }
 
-        JsonObject device = doc.createNestedObject("device");
-        device["identifiers"] = MQTT_CLIENT_ID;
-        device["name"] = "Caldera de Biomasa";
-        device["model"] = "Lumber Boiler Manager";
-        device["manufacturer"] = "ESP32";
+        uint32_t latency = micros() - previousService;
+        commandStats.commands++;
+        commandStats.lastLatency = latency;
+        commandStats.maxLatency = max(commandStats.maxLatency, latency);
+    }
 
-        char buffer[512];
-        serializeJson(doc, buffer);
+    enum DnsResult : uint8_t {
+        DNS_PENDING,
+        DNS_FOUND,
+        DNS_FAILED
+    };
+
+    // Start resolving MQTT_SERVER. Cached names and literal addresses are answered at
+    // once, otherwise dnsFound() reports from the lwIP task
+    void startResolve(unsigned long now) {
+        resolving = true;
+        resolveStarted = now;
+        dnsResult.store(DNS_PENDING, std::memory_order_relaxed);
+
+        ip_addr_t address;
+        err_t err = dns_gethostbyname(MQTT_SERVER, &address, dnsFound, this);
+        if (err == ERR_OK) {
+            dnsAddress.store(ip_2_ip4(&address)->addr, std::memory_order_relaxed);
+            dnsResult.store(DNS_FOUND, std::memory_order_release);
+        } else if (err != ERR_INPROGRESS) {
+            dnsResult.store(DNS_FAILED, std::memory_order_release);
+        }
+    }
 
-        String topic = String("homeassistant/sensor/lumber_boiler/") + id + "/config";
-        mqttClient.publish(topic.c_str(), buffer, true);
+    // lwIP callback, address is null if the name could not be resolved. A late answer to
+    // an attempt that timed out is for the same name, so it is harmless
+    static void dnsFound(const char* name, const ip_addr_t* address, void* arg) {
+        HomeAssistant* self = static_cast<HomeAssistant*>(arg);
+        if (address) {
+            self->dnsAddress.store(ip_2_ip4(address)->addr, std::memory_order_relaxed);
+            self->dnsResult.store(DNS_FOUND, std::memory_order_release);
+        } else {
+            self->dnsResult.store(DNS_FAILED, std::memory_order_release);
+        }
     }
 
-    void publishBinarySensor(const String& id, const String& name, const String& deviceClass) {
-        StaticJsonDocument<512> doc;
+    void setDisconnected(unsigned long now) {
+        serviceRunning = false;
+        if (state == MQTT_READY || state == MQTT_SUBSCRIBING || state == MQTT_DISCOVERY) {
+            disconnectedSince = now;
+        }
+    }
 
-        doc["name"] = name;
-        doc["state_topic"] = String(MQTT_BASE_TOPIC) + "/state";
-        doc["value_template"] = "{{ value_json." + id + " }}";
-        doc["unique_id"] = String("lumber_boiler_") + id;
-        doc["device_class"] = deviceClass;
+    // Drop back to backoff if the broker connection was lost
+    bool checkConnection(unsigned long now) {
+        if (mqttClient.connected()) {
+            return true;
+        }
+        setDisconnected(now);
+        backoff = MQTT_BACKOFF_MIN;
+        scheduleRetry(now);
+        return false;
+    }
 
-        JsonObject device = doc.createNestedObject("device");
-        device["identifiers"] = MQTT_CLIENT_ID;
-        device["name"] = "Caldera de Biomasa";
-        device["model"] = "Lumber Boiler Manager";
-        device["manufacturer"] = "ESP32";
+    // Exponential backoff with jitter, so several clients do not retry in lockstep
+    void scheduleRetry(unsigned long now) {
+        if (state == MQTT_RESOLVING || state == MQTT_CONNECTING) {
+            stats.failures++;
+        }
+        unsigned long delayMs = random(backoff / 2, backoff + 1);
+        retryAt = now + delayMs;
+        backoff = min((unsigned long)backoff * 2, (unsigned long)MQTT_BACKOFF_MAX);
+        stats.backoff = delayMs;
+        state = MQTT_BACKOFF;
+    }
 
-        char buffer[512];
-        serializeJson(doc, buffer);
+    void addBlocked(unsigned long startMicros) {
+        uint32_t blocked = (micros() - startMicros + 500) / 1000;
+        stats.blockedTotal += blocked;
+        stats.blockedMax = max(stats.blockedMax, blocked);
+    }
 
-        String topic = String("homeassistant/binary_sensor/lumber_boiler/") + id + "/config";
-        mqttClient.publish(topic.c_str(), buffer, true);
+    // Control topics, relative to MQTT_BASE_TOPIC
+    static const int SUBSCRIPTION_COUNT = 5;
+
+    static const char* subscription(int index) {
+        static const char* const topics[SUBSCRIPTION_COUNT] = {
+            "/set/target_burning_temp",
+            "/set/boiler_pump",
+            "/set/heating_pump",
+            "/set/fans",
+            "/set/other_relay"
+        };
+        return topics[index];
     }
 
-    void publishNumberControl(const String& id, const String& name, const String& deviceClass,
-                             const String& unitOfMeasurement, float min, float max, float step) {
-        StaticJsonDocument<512> doc;
+    // Home Assistant discovery entities. The payloads are generated from this table
+    // (constant data in flash) and streamed straight into the MQTT client
+    struct DiscoveryEntity {
+        const char* component;     // sensor, binary_sensor or number
+        const char* id;            // State field, also the unique id and command topic suffix
+        const char* name;
+        const char* deviceClass;   // nullptr = none
+        const char* unit;          // nullptr = none
+        const char* range;         // number only: min, max and step as JSON members
+    };
+
+    static constexpr int DISCOVERY_COUNT = 18;
+
+    static const DiscoveryEntity& discoveryEntity(int index) {
+        static constexpr DiscoveryEntity entities[DISCOVERY_COUNT] = {
+            // Temperaturas
+            {"sensor", "boiler_water_temp", "Temperatura Agua Caldera", "temperature", "°C", nullptr},
+            {"sensor", "heating_temp", "Temperatura Calefacción", "temperature", "°C", nullptr},
+            {"sensor", "burning_temp", "Temperatura Combustión", "temperature", "°C", nullptr},
+            {"sensor", "ambient_temp", "Temperatura Ambiente", "temperature", "°C", nullptr},
+
+            // Relés
+            {"binary_sensor", "boiler_pump", "Bomba Caldera", "connectivity", nullptr, nullptr},
+            {"binary_sensor", "heating_pump", "Bomba Calefacción", "connectivity", nullptr, nullptr},
+            {"binary_sensor", "fans", "Ventiladores", "connectivity", nullptr, nullptr},
+            {"binary_sensor", "other_relay", "Otro Dispositivo", "connectivity", nullptr, nullptr},
+
+            // Seguridad: fallo en alguna sonda y modo de emergencia
+            {"binary_sensor", "sensor_fault", "Fallo de Sonda", "problem", nullptr, nullptr},
+            {"binary_sensor", "killswitch", "Modo Emergencia", "problem", nullptr, nullptr},
+
+            // Temperatura objetivo de combustión (control)
+            {"number", "target_burning_temp", "Temperatura Objetivo", "temperature", "°C",
+             "\"min\":60,\"max\":100,\"step\":1"},
+
+            // Entrada de aire y su rango de servo
+            {"sensor", "air_intake", "Entrada de Aire", "power_factor", "%", nullptr},
+            {"sensor", "servo_min", "Servo Mínimo", nullptr, "°", nullptr},
+            {"sensor", "servo_max", "Servo Máximo", nullptr, "°", nullptr},
+
+            // PID: estado del autoajuste y parámetros actuales
+            {"sensor", "autotune", "Estado Autoajuste PID", nullptr, nullptr, nullptr},
+            {"sensor", "pid_kp", "PID Kp", nullptr, nullptr, nullptr},
+            {"sensor", "pid_ki", "PID Ki", nullptr, nullptr, nullptr},
+            {"sensor", "pid_kd", "PID Kd", nullptr, nullptr, nullptr}
+        };
+        return entities[index];
+    }
 
-        doc["name"] = name;
-        doc["command_topic"] = String(MQTT_BASE_TOPIC) + "/set/" + id;
-        doc["state_topic"] = String(MQTT_BASE_TOPIC) + "/state";
-        doc["value_template"] = "{{ value_json." + id + " }}";
-        doc["unique_id"] = String("lumber_boiler_") + id;
-        doc["device_class"] = deviceClass;
-        doc["unit_of_measurement"] = unitOfMeasurement;
-        doc["min"] = min;
-        doc["max"] = max;
-        doc["step"] = step;
+    // Discovery payload of one entity, written piece by piece
+    static void writeDiscovery(Print& out, const DiscoveryEntity& entity) {
+        out.print("{\"name\":\"");
+        out.print(entity.name);
+#if MQTT_PER_FIELD_TOPICS
+        out.print("\",\"state_topic\":\"" MQTT_BASE_TOPIC "/state/");
+        out.print(entity.id);
+#else
+        out.print("\",\"state_topic\":\"" MQTT_BASE_TOPIC "/state\",\"value_template\":\"{{ value_json.");
+        out.print(entity.id);
+        out.print(" }}");
+#endif
+        out.print("\",\"unique_id\":\"lumber_boiler_");
+        out.print(entity.id);
+        out.print("\"");
+        if (entity.deviceClass) {
+            out.print(",\"device_class\":\"");
+            out.print(entity.deviceClass);
+            out.print("\"");
+        }
+        if (entity.unit) {
+            out.print(",\"unit_of_measurement\":\"");
+            out.print(entity.unit);
+            out.print("\"");
+        }
+        if (entity.range) {
+            out.print(",\"command_topic\":\"" MQTT_BASE_TOPIC "/set/");
+            out.print(entity.id);
+            out.print("\",");
+            out.print(entity.range);
+        }
+        out.print(",\"device\":{\"identifiers\":\"" MQTT_CLIENT_ID "\",\"name\":\"Caldera de Biomasa\","
+                  "\"model\":\"Lumber Boiler Manager\",\"manufacturer\":\"ESP32\"}}");
+    }
 
-        JsonObject device = doc.createNestedObject("device");
-        device["identifiers"] = MQTT_CLIENT_ID;
-        device["name"] = "Caldera de Biomasa";
-        device["model"] = "Lumber Boiler Manager";
-        device["manufacturer"] = "ESP32";
+    // Publish one Home Assistant discovery entity. Returns whether it was sent
+    bool publishDiscoveryEntity(int index) {
+        const DiscoveryEntity& entity = discoveryEntity(index);
 
-        char buffer[512];
-        serializeJson(doc, buffer);
+        char topic[96];
+        snprintf(topic, sizeof(topic), "homeassistant/%s/lumber_boiler/%s/config", entity.component, entity.id);
 
-        String topic = String("homeassistant/number/lumber_boiler/") + id + "/config";
-        mqttClient.publish(topic.c_str(), buffer, true);
+        return publishStream(topic, true, [&](Print& out) {
+            writeDiscovery(out, entity);
+        });
     }
 
+    WiFiClient& wifiClient;
     PubSubClient mqttClient;
-    bool mqttConnected;
+    MqttState state;
+    unsigned long backoff;
+    unsigned long retryAt;
+    unsigned long disconnectedSince;
+    int step;  // Next subscription or discovery entity
+    IPAddress brokerIp;
+    bool haveBrokerIp;
+    bool resolving = false;                          // A DNS lookup was started
+    unsigned long resolveStarted = 0;
+    std::atomic<uint8_t> dnsResult{DNS_PENDING};     // Written by dnsFound()
+    std::atomic<uint32_t> dnsAddress{0};             // IPv4, network byte order
+    ConnectionStats stats;
+
+    std::function<void(char*, uint8_t*, unsigned int)> commandCallback;
+    uint32_t lastService = 0;       // micros() of the last service call
+    uint32_t previousService = 0;   // micros() of the one before
+    bool serviceRunning = false;    // Service calls are continuous (gap is meaningful)
+    CommandStats commandStats;
+    // Last published value of every field
+    float published[FIELD_COUNT];
+    bool publishedOnce = false;
+    unsigned long lastFullPublish = 0;
+    unsigned long lastAnalogPublish = 0;
+    TelemetryStats telemetryStats = {0, 0};
+
+    // Store-and-forward while the broker is unreachable
+    TelemetryQueue telemetryQueue;
+    unsigned long lastQueued = 0;
+    unsigned long lastReplay = 0;
 };
 
 #endif // HOME_ASSISTANT_H
@@ -0,0 +1,235 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <Arduino.h>
+
+// Streaming JSON writer.
+// Writes members straight into any Print (AsyncResponseStream, PubSubClient between
+// beginPublish() and endPublish(), ...) with no document, String or heap in between.
+// Commas are tracked per nesting level. NaN and infinity are written as null, as
+// ArduinoJson does
+class JsonWriter {
+public:
+    static const int MAX_DEPTH = 8;
+
+    JsonWriter(Print& out) : out(out), depth(0) {
+        first[0] = true;
+    }
+
+    // key is nullptr at the top level and inside arrays
+    void beginObject(const char* key = nullptr) {
+        writeKey(key);
+        out.write('{');
+        push();
+    }
+
+    void endObject() {
+        pop();
+        out.write('}');
+    }
+
+    void beginArray(const char* key = nullptr) {
+        writeKey(key);
+        out.write('[');
+        push();
+    }
+
+    void endArray() {
+        pop();
+        out.write(']');
+    }
+
+    void add(const char* key, const char* value) {
+        writeKey(key);
+        if (value) {
+            writeString(value);
+        } else {
+            out.print("null");
+        }
+    }
+
+    void add(const char* key, bool value) {
+        writeKey(key);
+        out.print(value ? "true" : "false");
+    }
+
+    void add(const char* key, int value) { addInteger(key, "%d", value); }
+    void add(const char* key, unsigned int value) { addInteger(key, "%u", value); }
+    void add(const char* key, long value) { addInteger(key, "%ld", value); }
+    void add(const char* key, unsigned long value) { addInteger(key, "%lu", value); }
+
+    // Up to 6 significant digits, enough for every measurement in this project
+    void add(const char* key, double value) {
+        writeKey(key);
+        if (isnan(value) || isinf(value)) {
+            out.print("null");
+            return;
+        }
+        char text[16];
+        int length = snprintf(text, sizeof(text), "%.6g", value);
+        out.write((const uint8_t*)text, length);
+    }
+
+    void add(const char* key, float value) {
+        add(key, (double)value);
+    }
+
+private:
+    template <typename T>
+    void addInteger(const char* key, const char* format, T value) {
+        writeKey(key);
+        char text[12];
+        int length = snprintf(text, sizeof(text), format, value);
+        out.write((const uint8_t*)text, length);
+    }
+
+    void writeKey(const char* key) {
+        if (!first[depth]) {
+            out.write(',');
+        }
+        first[depth] = false;
+        if (key) {
+            writeString(key);
+            out.write(':');
+        }
+    }
+
+    // Copies unescaped runs in one write
+    void writeString(const char* text) {
+        out.write('"');
+        const char* run = text;
+        for (const char* p = text; *p; p++) {
+            char c = *p;
+            if (c != '"' && c != '\\' && (uint8_t)c >= 0x20) {
+                continue;
+            }
+            out.write((const uint8_t*)run, p - run);
+            char escaped[7];
+            switch (c) {
+                case '"': out.print("\\\""); break;
+                case '\\': out.print("\\\\"); break;
+                case '\n': out.print("\\n"); break;
+                case '\r': out.print("\\r"); break;
+                case '\t': out.print("\\t"); break;
+                default:
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", (uint8_t)c);
+                    out.print(escaped);
+                    break;
+            }
+            run = p + 1;
+        }
+        out.write((const uint8_t*)run, strlen(run));
+        out.write('"');
+    }
+
+    void push() {
+        if (depth < MAX_DEPTH - 1) {
+            depth++;
+        }
+        first[depth] = true;
+    }
+
+    void pop() {
+        if (depth > 0) {
+            depth--;
+        }
+    }
+
+    Print& out;
+    int depth;
+    bool first[MAX_DEPTH];
+};
+
+// Counts the bytes written, to announce a payload length before streaming it
+class PrintCounter : public Print {
+public:
+    size_t count = 0;
+
+    size_t write(uint8_t) override {
+        count++;
+        return 1;
+    }
+
+    size_t write(const uint8_t*, size_t size) override {
+        count += size;
+        return size;
+    }
+};
+
+// Writes into a caller supplied char buffer, always NUL terminated. Output that does not
+// fit is dropped and flagged
+class BufferPrint : public Print {
+public:
+    BufferPrint(char* buffer, size_t size) : buffer(buffer), size(size), length(0), overflow(false) {
+        buffer[0] = '\0';
+    }
+
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+
+    size_t write(const uint8_t* data, size_t count) override {
+        if (length + count >= size) {
+            overflow = true;
+            return 0;
+        }
+        memcpy(buffer + length, data, count);
+        length += count;
+        buffer[length] = '\0';
+        return count;
+    }
+
+    const char* c_str() const { return buffer; }
+    size_t getLength() const { return length; }
+    bool isOverflow() const { return overflow; }
+
+private:
+    char* buffer;
+    size_t size;
+    size_t length;
+    bool overflow;
+};
+
+// Coalesces small writes into chunks of N bytes, for sinks where every write is a
+// network send (PubSubClient after beginPublish() writes straight to the socket).
+// Call flush() before finishing the message
+template <size_t N>
+class ChunkedPrint : public Print {
+public:
+    ChunkedPrint(Print& out) : out(out), used(0) {}
+
+    size_t write(uint8_t c) override {
+        if (used == N) {
+            flush();
+        }
+        buffer[used++] = c;
+        return 1;
+    }
+
+    size_t write(const uint8_t* data, size_t size) override {
+        for (size_t done = 0; done < size;) {
+            if (used == N) {
+                flush();
+            }
+            size_t chunk = min(size - done, N - used);
+            memcpy(buffer + used, data + done, chunk);
+            used += chunk;
+            done += chunk;
+        }
+        return size;
+    }
+
+    void flush() {
+        if (used) {
+            out.write(buffer, used);
+            used = 0;
+        }
+    }
+
+private:
+    Print& out;
+    uint8_t buffer[N];
+    size_t used;
+};
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,241 @@
+#ifndef LIVE_EVENTS_H
+#define LIVE_EVENTS_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <atomic>
+#include "config.h"
+#include "json_writer.h"
+#include "log_buffer.h"
+#include "status_cache.h"
+#include "system_state.h"
+
+// Live push of the state and the log to the web interface (Server-Sent Events).
+// Events, with the same JSON keys as /api/status:
+//   status: the whole cached /api/status JSON. Sent when a client connects, after the
+//           clients fell behind and at least every EVENTS_KEYFRAME_INTERVAL
+//   state:  the members shown by the web interface that changed since the last event
+//   log:    lines logged since the last event
+// Everything is sent from loop() in update(); the web server task only accepts clients.
+// ESPAsyncWebServer queues at most SSE_MAX_QUEUED_MESSAGES per client and drops the rest
+// for that client alone, so a slow browser neither holds memory nor delays the others.
+// While the clients are behind on average, deltas and log lines are held back and the
+// next update sends a status event instead, which brings every client up to date
+class LiveEvents {
+public:
+    struct Stats {
+        uint32_t clients;
+        uint32_t rejected;     // Connections refused, EVENTS_MAX_CLIENTS reached
+        uint32_t keyframes;    // status events
+        uint32_t deltas;       // state events
+        uint32_t logs;         // log events
+        uint32_t heldBack;     // Updates deferred because the clients were behind
+    };
+
+    LiveEvents(const char* url) : source(url), keyframePending(false), rejected(0), resync(true),
+                                  lastKeyframe(0), logSequence(0), keyframes(0), deltas(0), logs(0),
+                                  heldBack(0) {}
+
+    void begin(AsyncWebServer& server) {
+        // Refused requests fall through to the other handlers (404), the page then polls
+        source.setFilter([this](AsyncWebServerRequest* request) {
+            if (source.count() >= EVENTS_MAX_CLIENTS) {
+                rejected.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            return true;
+        });
+        source.onConnect([this](AsyncEventSourceClient* client) {
+            keyframePending.store(true, std::memory_order_release);
+        });
+        server.addHandler(&source);
+    }
+
+    // loop(): push what changed. state is the last published state and cache its JSON
+    void update(const SystemState& state, const StatusCache& cache, LogBuffer& log) {
+        if (source.count() == 0) {
+            // Clients load the log history with /api/logs when they connect
+            logSequence = log.getSequence();
+            resync = true;
+            return;
+        }
+
+        if (source.avgPacketsWaiting() > EVENTS_MAX_BACKLOG) {
+            heldBack++;
+            resync = true;
+            return;
+        }
+
+        unsigned long now = millis();
+        if (keyframePending.exchange(false, std::memory_order_acquire) || resync ||
+            now - lastKeyframe >= EVENTS_KEYFRAME_INTERVAL) {
+            sendKeyframe(state, cache, now);
+        } else {
+            sendDelta(state, cache, now);
+        }
+
+        sendLog(log);
+    }
+
+    Stats getStats() {
+        Stats stats;
+        stats.clients = source.count();
+        stats.rejected = rejected.load(std::memory_order_relaxed);
+        stats.keyframes = keyframes;
+        stats.deltas = deltas;
+        stats.logs = logs;
+        stats.heldBack = heldBack;
+        return stats;
+    }
+
+private:
+    // Lines logged since the last event, EVENTS_LOG_CHUNK bytes per event at most. The
+    // event id is the sequence number of its last line (see /api/logs?since=)
+    void sendLog(LogBuffer& log) {
+        LogBuffer::Cursor cursor = log.read(logSequence);
+        char buffer[EVENTS_LOG_CHUNK + 1];
+        size_t length;
+        while ((length = log.copy(cursor, (uint8_t*)buffer, EVENTS_LOG_CHUNK)) > 0) {
+            // Trailing newline dropped, every line becomes one data: field
+            if (buffer[length - 1] == '\n') {
+                length--;
+            }
+            buffer[length] = '\0';
+            source.send(buffer, "log", cursor.next - 1);
+            logs++;
+        }
+        logSequence = cursor.end;
+    }
+
+    void sendKeyframe(const SystemState& state, const StatusCache& cache, unsigned long now) {
+        // Sent straight from the cache, which send() copies for each client. loop() builds
+        // the cache, so this never races with a rebuild
+        if (cache.isEmpty()) {
+            return;
+        }
+        cache.read([this](const char* json, size_t) {
+            source.send(json, "status");
+        });
+        keyframes++;
+        sent = state;
+        resync = false;
+        lastKeyframe = now;
+    }
+
+    void sendDelta(const SystemState& state, const StatusCache& cache, unsigned long now) {
+        bool moved[SENSOR_CHANNEL_COUNT];
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            moved[i] = temperatureMoved(sent.sensors.temperature[i], state.sensors.temperature[i]);
+        }
+
+        char buffer[EVENTS_DELTA_SIZE];
+        BufferPrint out(buffer, sizeof(buffer));
+        JsonWriter json(out);
+        json.beginObject();
+        writeDelta(json, state, moved);
+        json.endObject();
+
+        if (out.isOverflow()) {
+            sendKeyframe(state, cache, now);
+            return;
+        }
+        if (out.getLength() <= 2) {
+            return;  // {}: nothing changed
+        }
+        source.send(out.c_str(), "state");
+        deltas++;
+
+        // Temperatures within the deadband keep the value last sent, so slow drifts add up
+        float temperatures[SENSOR_CHANNEL_COUNT];
+        memcpy(temperatures, sent.sensors.temperature, sizeof(temperatures));
+        sent = state;
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            if (!moved[i]) {
+                sent.sensors.temperature[i] = temperatures[i];
+            }
+        }
+    }
+
+    void writeDelta(JsonWriter& json, const SystemState& state, const bool* moved) {
+        static const char* const temperatureKeys[SENSOR_CHANNEL_COUNT] = {
+            "boiler_water_temp", "heating_temp", "burning_temp", "ambient_temp"
+        };
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            if (moved[i]) {
+                json.add(temperatureKeys[i], state.sensors.temperature[i]);
+            }
+        }
+
+        if (state.boilerPump != sent.boilerPump) json.add("boiler_pump", state.boilerPump);
+        if (state.heatingPump != sent.heatingPump) json.add("heating_pump", state.heatingPump);
+        if (state.fans != sent.fans) json.add("fans", state.fans);
+        if (state.otherRelay != sent.otherRelay) json.add("other", state.otherRelay);
+        if (state.targetBurningTemp != sent.targetBurningTemp) json.add("target_burning_temp", state.targetBurningTemp);
+        if (state.airIntake != sent.airIntake) json.add("air_intake", state.airIntake);
+        if (state.autoTuning != sent.autoTuning) json.add("auto_tuning", state.autoTuning);
+        if (state.killSwitch != sent.killSwitch) json.add("killswitch_active", state.killSwitch);
+        if (state.servoMin != sent.servoMin) json.add("servo_min", state.servoMin);
+        if (state.servoMax != sent.servoMax) json.add("servo_max", state.servoMax);
+
+        if (state.kp != sent.kp || state.ki != sent.ki || state.kd != sent.kd) {
+            json.beginObject("pid");
+            json.add("kp", state.kp);
+            json.add("ki", state.ki);
+            json.add("kd", state.kd);
+            json.endObject();
+        }
+
+        if (state.autoTune.state != sent.autoTune.state || state.autoTune.cycles != sent.autoTune.cycles) {
+            json.beginObject("autotune");
+            json.add("state", PIDAutoTune::stateName(state.autoTune.state));
+            json.add("cycles", state.autoTune.cycles);
+            json.endObject();
+        }
+
+        if (state.safetyActive != sent.safetyActive || state.safetyReason != sent.safetyReason) {
+            json.beginObject("safety");
+            json.add("active", state.safetyActive);
+            json.add("reason", SafetySupervisor::reasonName(state.safetyReason));
+            json.endObject();
+        }
+
+        bool healthChanged = false;
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            healthChanged |= state.sensors.health[i] != sent.sensors.health[i];
+        }
+        if (healthChanged) {
+            json.beginObject("sensor_health");
+            for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+                if (state.sensors.health[i] != sent.sensors.health[i]) {
+                    json.beginObject(sensorChannelName(i));
+                    json.add("state", SensorHealth::stateName(state.sensors.health[i]));
+                    json.endObject();
+                }
+            }
+            json.endObject();
+        }
+    }
+
+    static bool temperatureMoved(float last, float current) {
+        if (isnan(last) || isnan(current)) {
+            return isnan(last) != isnan(current);
+        }
+        return fabsf(current - last) >= EVENTS_TEMP_DEADBAND;
+    }
+
+    AsyncEventSource source;
+    std::atomic<bool> keyframePending;   // Set by the web server task on connect
+    std::atomic<uint32_t> rejected;
+
+    // loop() only
+    bool resync;
+    unsigned long lastKeyframe;
+    uint32_t logSequence;                // Last log message pushed
+    SystemState sent;                    // State as the clients last saw it
+    uint32_t keyframes;
+    uint32_t deltas;
+    uint32_t logs;
+    uint32_t heldBack;
+};
+
+#endif // LIVE_EVENTS_H
@@ -1,63 +1,440 @@
 #ifndef LOG_BUFFER_H
 #define LOG_BUFFER_H
 
-#include <Arduino.h>
-#include <CircularBuffer.hpp>
+#include "arduino_compat.h"
+#include <atomic>
 #include "config.h"
+#include "log_messages.h"
 
+// In-RAM log kept in one preallocated byte arena (LOG_ARENA_SIZE), with no heap use.
+// Each message is a variable length binary record: header (timestamp, level, source,
+// message id) followed by its arguments, each a type tag and 4 bytes, or a length and
+// up to LOG_MAX_STRING characters for strings. Records are written back to back and
+// wrap around; the oldest ones are dropped to make room. The text is only produced when
+// the log is read, from the format in log_messages.h. Nothing is printed here: LogDrain
+// copies the log to Serial in the background.
+// Log through the LOG_ERROR() ... LOG_TRACE() macros below: levels above
+// LOG_COMPILE_LEVEL are not compiled in, and each source has a runtime level
+// (setLevel(), /api/settings) checked before the arguments are evaluated
 class LogBuffer {
 public:
-    LogBuffer() {}
+    static const size_t MAX_RECORD = 128;    // Header + arguments, longer ones are truncated
+
+    // Position of a reader in the log: streams messages next..end, one line each
+    struct Cursor {
+        uint32_t next;      // Sequence number of the next message to copy
+        uint32_t end;       // Last message to copy
+        size_t offset;      // Bytes of message `next` already copied
+        uint32_t lost;      // Messages overwritten before they could be copied
+        uint32_t fetched;   // Last message read from the arena (0 = none), so the next
+        size_t position;    // one is found from its arena offset instead of from the oldest
+    };
+
+    struct Stats {
+        uint32_t entries;     // Records in the arena
+        uint32_t bytesUsed;   // Arena bytes holding records
+        uint32_t logged;      // Messages logged since boot
+        uint32_t dropped;     // Records overwritten to make room
+    };
+
+    LogBuffer() : mutex(nullptr), head(0), tail(0), wrap(LOG_ARENA_SIZE), count(0), used(0),
+                  total(0), dropped(0), alarm(0) {
+        for (int i = 0; i < LOG_SOURCE_COUNT; i++) {
+            levels[i] = min(LOG_DEFAULT_LEVEL, LOG_COMPILE_LEVEL);
+        }
+    }
 
     void begin() {
-        // No specific initialization needed
+        // Messages come from loop(), the control task and the web server task
+        mutex = xSemaphoreCreateMutex();
     }
 
-    // Add a message to the buffer
-    void log(const String& message) {
-        // Create an entry with timestamp
-        char timestamp[20];
-        unsigned long now = millis();
-        sprintf(timestamp, "[%10lu] ", now);
-        String entry = String(timestamp) + message;
+    // Whether a message at this level passes the runtime level of its source
+    bool isEnabled(LogLevel level, LogMessage message) const {
+        return level <= levels[logMessageInfo(message).source].load(std::memory_order_relaxed);
+    }
 
-        // Add to circular buffer
-        buffer.push(entry);
+    // Most verbose level logged for a source, capped at LOG_COMPILE_LEVEL
+    void setLevel(uint8_t source, uint8_t level) {
+        if (source < LOG_SOURCE_COUNT && level >= LOG_LEVEL_ERROR) {
+            levels[source].store(min(level, (uint8_t)LOG_COMPILE_LEVEL), std::memory_order_relaxed);
+        }
+    }
 
-        // Also send to Serial
-        Serial.println(entry);
+    uint8_t getLevel(uint8_t source) const {
+        return source < LOG_SOURCE_COUNT ? levels[source].load(std::memory_order_relaxed) : 0;
     }
 
-    // Get all messages from the buffer as a single string
-    String getAll() {
-        String result = "";
+    // Add a message: level, id from log_messages.h and its arguments (integers, floats,
+    // strings). Not filtered here, use the LOG_* macros
+    template <typename... Args>
+    void log(LogLevel level, LogMessage message, Args... args) {
+        const LogMessageInfo& info = logMessageInfo(message);
+        uint8_t record[MAX_RECORD];
+        Header header = {0, (uint16_t)message, (uint32_t)millis(), level, info.source};
+        size_t size = sizeof(Header);
+        (encode(record, size, args), ...);
+        header.size = size;
+        memcpy(record, &header, sizeof(Header));
 
-        for (int i = 0; i < buffer.size(); i++) {
-            result += buffer[i] + "\n";
+        lock();
+        store(record, size);
+        if (level == LOG_LEVEL_ERROR) {
+            alarm = total;
         }
+        unlock();
+    }
 
-        return result;
+    // Sequence number of the last message logged (0 = none). Messages are numbered from
+    // 1 and keep their number while they stay in the buffer
+    uint32_t getSequence() {
+        lock();
+        uint32_t sequence = total;
+        unlock();
+        return sequence;
     }
 
-    // Get the last N messages as a single string
-    String getLast(int count) {
-        String result = "";
-        int start = max(0, buffer.size() - count);
+    // Sequence number of the last error (alarm) message, 0 = none
+    uint32_t getAlarmSequence() {
+        lock();
+        uint32_t sequence = alarm;
+        unlock();
+        return sequence;
+    }
+
+    // Cursor over the messages logged after `since`, up to the last one logged so far.
+    // Messages already overwritten are skipped. A `since` from before a reboot (larger
+    // than the current sequence) starts from the oldest message
+    Cursor read(uint32_t since) {
+        lock();
+        Cursor cursor = {since <= total ? since + 1 : 1, total, 0, 0, 0, 0};
+        unlock();
+        return cursor;
+    }
+
+    // Copy whole lines ("message\n") from the cursor into out and advance it. A message
+    // longer than size is split over several calls. Returns 0 once the cursor reached its end
+    size_t copy(Cursor& cursor, uint8_t* out, size_t size) {
+        size_t written = 0;
+        uint8_t record[MAX_RECORD];
+        char line[LOG_LINE_SIZE];
 
-        for (int i = start; i < buffer.size(); i++) {
-            result += buffer[i] + "\n";
+        while (written < size) {
+            // Only the record copy needs the lock, formatting happens outside
+            lock();
+            uint32_t oldest = total - count + 1;
+            if (cursor.next < oldest) {
+                cursor.lost += min(oldest, cursor.end + 1) - cursor.next;
+                cursor.next = oldest;
+                cursor.offset = 0;
+            }
+            bool found = cursor.next <= cursor.end && fetch(cursor, oldest, record);
+            unlock();
+            if (!found) {
+                break;
+            }
+
+            size_t length = format(record, line, sizeof(line) - 1);
+            line[length++] = '\n';
+            size_t remaining = length - cursor.offset;
+            if (remaining > size - written && written > 0) {
+                break;  // Next call, so lines are not split between chunks
+            }
+
+            size_t chunk = min(remaining, size - written);
+            memcpy(out + written, line + cursor.offset, chunk);
+            written += chunk;
+            cursor.offset += chunk;
+            if (chunk == remaining) {
+                cursor.next++;
+                cursor.offset = 0;
+            }
         }
 
-        return result;
+        return written;
+    }
+
+    Stats getStats() {
+        lock();
+        Stats stats = {count, used, total, dropped};
+        unlock();
+        return stats;
     }
 
     // Clear the buffer
     void clear() {
-        buffer.clear();
+        lock();
+        head = tail = 0;
+        wrap = LOG_ARENA_SIZE;
+        count = 0;
+        used = 0;
+        unlock();
     }
 
 private:
-    CircularBuffer<String, LOG_BUFFER_SIZE> buffer;
+    struct Header {
+        uint16_t size;        // Whole record, header included
+        uint16_t message;     // LogMessage
+        uint32_t timestamp;   // millis()
+        uint8_t level;
+        uint8_t source;
+    };
+
+    enum ArgumentType : uint8_t {
+        ARG_INT = 0,
+        ARG_UINT,
+        ARG_FLOAT,
+        ARG_STRING            // Length byte and characters, not terminated
+    };
+
+    // Arguments that do not fit in MAX_RECORD are left out
+    static void encodeValue(uint8_t* record, size_t& size, ArgumentType type, const void* value) {
+        if (size + 5 > MAX_RECORD) {
+            return;
+        }
+        record[size] = type;
+        memcpy(record + size + 1, value, 4);
+        size += 5;
+    }
+
+    static void encode(uint8_t* record, size_t& size, int value) {
+        int32_t v = value;
+        encodeValue(record, size, ARG_INT, &v);
+    }
+
+    static void encode(uint8_t* record, size_t& size, long value) {
+        int32_t v = value;
+        encodeValue(record, size, ARG_INT, &v);
+    }
+
+    static void encode(uint8_t* record, size_t& size, unsigned int value) {
+        uint32_t v = value;
+        encodeValue(record, size, ARG_UINT, &v);
+    }
+
+    static void encode(uint8_t* record, size_t& size, unsigned long value) {
+        uint32_t v = value;
+        encodeValue(record, size, ARG_UINT, &v);
+    }
+
+    static void encode(uint8_t* record, size_t& size, uint8_t value) {
+        encode(record, size, (unsigned int)value);
+    }
+
+    static void encode(uint8_t* record, size_t& size, double value) {
+        float v = value;
+        encodeValue(record, size, ARG_FLOAT, &v);
+    }
+
+    static void encode(uint8_t* record, size_t& size, float value) {
+        encodeValue(record, size, ARG_FLOAT, &value);
+    }
+
+    static void encode(uint8_t* record, size_t& size, const char* value) {
+        if (size + 2 > MAX_RECORD) {
+            return;
+        }
+        size_t length = value ? strlen(value) : 0;
+        length = min(length, min((size_t)LOG_MAX_STRING, MAX_RECORD - size - 2));
+        record[size] = ARG_STRING;
+        record[size + 1] = length;
+        memcpy(record + size + 2, value, length);
+        size += 2 + length;
+    }
+
+    // Line for a record: "[timestamp] LEVEL source: text". Returns its length
+    static size_t format(const uint8_t* record, char* line, size_t lineSize) {
+        Header header;
+        memcpy(&header, record, sizeof(Header));
+        const char* text = logMessageInfo(header.message).format;
+
+        int length = snprintf(line, lineSize, "[%10lu] %-5s %s: ", (unsigned long)header.timestamp,
+                              logLevelName(header.level), logSourceName(header.source));
+        size_t pos = min((size_t)max(length, 0), lineSize - 1);
+        size_t arg = sizeof(Header);
+
+        for (const char* p = text; *p && pos < lineSize - 1;) {
+            if (*p != '%') {
+                line[pos++] = *p++;
+                continue;
+            }
+            if (p[1] == '%') {
+                line[pos++] = '%';
+                p += 2;
+                continue;
+            }
+
+            // Conversion: flags, width and precision are kept, the type comes from the record.
+            // At most sizeof(spec) - 4 characters, to leave room for "ld" and the terminator
+            char spec[12];
+            const char* start = p++;
+            while (*p && strchr("-+ #0123456789.", *p) && (size_t)(p - start) < sizeof(spec) - 4) {
+                p++;
+            }
+            size_t specLength = p - start;
+            while (*p == 'l' || *p == 'h' || *p == 'z') {
+                p++;
+            }
+            char conversion = *p ? *p++ : 's';
+            memcpy(spec, start, specLength);
+
+            if (arg >= header.size) {
+                continue;  // Argument left out for lack of space
+            }
+            ArgumentType type = (ArgumentType)record[arg];
+            int written = 0;
+            if (type == ARG_STRING) {
+                char value[LOG_MAX_STRING + 1];
+                size_t valueLength = record[arg + 1];
+                memcpy(value, record + arg + 2, valueLength);
+                value[valueLength] = '\0';
+                arg += 2 + valueLength;
+                memcpy(spec + specLength, "s", 2);
+                written = snprintf(line + pos, lineSize - pos, spec, value);
+            } else {
+                uint8_t raw[4];
+                memcpy(raw, record + arg + 1, 4);
+                arg += 5;
+                if (type == ARG_FLOAT) {
+                    float value;
+                    memcpy(&value, raw, 4);
+                    spec[specLength] = strchr("eEfgG", conversion) ? conversion : 'g';
+                    spec[specLength + 1] = '\0';
+                    written = snprintf(line + pos, lineSize - pos, spec, (double)value);
+                } else if (type == ARG_INT) {
+                    int32_t value;
+                    memcpy(&value, raw, 4);
+                    memcpy(spec + specLength, "ld", 3);
+                    written = snprintf(line + pos, lineSize - pos, spec, (long)value);
+                } else {
+                    uint32_t value;
+                    memcpy(&value, raw, 4);
+                    spec[specLength] = 'l';
+                    spec[specLength + 1] = strchr("xXo", conversion) ? conversion : 'u';
+                    spec[specLength + 2] = '\0';
+                    written = snprintf(line + pos, lineSize - pos, spec, (unsigned long)value);
+                }
+            }
+            pos = min(pos + max(written, 0), lineSize - 1);
+        }
+
+        line[pos] = '\0';
+        return pos;
+    }
+
+    // Append a record, dropping the oldest ones until it fits. Called with the lock held
+    void store(const uint8_t* record, size_t size) {
+        for (;;) {
+            if (count == 0) {
+                head = tail = 0;
+                wrap = LOG_ARENA_SIZE;
+            }
+            if (tail > head || count == 0) {
+                // [head, tail) in use: room at the end, or start again from the beginning
+                if (tail + size <= LOG_ARENA_SIZE) {
+                    break;
+                }
+                wrap = tail;
+                tail = 0;
+            } else if (tail + size <= head) {
+                // Wrapped, [tail, head) is free
+                break;
+            } else {
+                dropOldest();
+            }
+        }
+
+        memcpy(arena + tail, record, size);
+        tail += size;
+        used += size;
+        count++;
+        total++;
+    }
+
+    void dropOldest() {
+        uint16_t size;
+        memcpy(&size, arena + head, sizeof(size));
+        head += size;
+        used -= size;
+        count--;
+        dropped++;
+        if (head >= wrap) {
+            head = 0;
+            wrap = LOG_ARENA_SIZE;
+        }
+    }
+
+    // Copy record cursor.next, oldest being the sequence number of the record at head.
+    // Walks from the record the cursor fetched last while that one is still in the arena
+    // (a step or none), otherwise from head. Called with the lock held
+    bool fetch(Cursor& cursor, uint32_t oldest, uint8_t* record) {
+        uint32_t index = cursor.next - oldest;
+        if (index >= count) {
+            return false;
+        }
+        size_t offset = head;
+        uint32_t start = 0;
+        if (cursor.fetched >= oldest && cursor.fetched <= cursor.next) {
+            offset = cursor.position;
+            start = cursor.fetched - oldest;
+        }
+        uint16_t size;
+        for (uint32_t i = start;; i++) {
+            if (offset >= wrap) {
+                offset = 0;
+            }
+            memcpy(&size, arena + offset, sizeof(size));
+            if (i == index) {
+                break;
+            }
+            offset += size;
+        }
+        memcpy(record, arena + offset, size);
+        cursor.fetched = cursor.next;
+        cursor.position = offset;
+        return true;
+    }
+
+    void lock() {
+        if (mutex) xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+
+    void unlock() {
+        if (mutex) xSemaphoreGive(mutex);
+    }
+
+    uint8_t arena[LOG_ARENA_SIZE];
+    SemaphoreHandle_t mutex;
+    size_t head;        // Oldest record
+    size_t tail;        // Where the next record goes
+    size_t wrap;        // End of the records before tail went back to the start
+    uint32_t count;     // Records in the arena
+    uint32_t used;      // Bytes of those records
+    uint32_t total;     // Messages logged since boot (sequence number of the newest)
+    uint32_t dropped;
+    uint32_t alarm;     // Sequence number of the last LOG_LEVEL_ERROR message
+    std::atomic<uint8_t> levels[LOG_SOURCE_COUNT];   // Runtime level per LogSource
 };
 
+// The firmware log, defined in main.cpp
+extern LogBuffer logBuffer;
+
+// Leveled logging: LOG_INFO(MSG_SYSTEM_READY), LOG_WARN(MSG_COMMAND_REJECTED, name, reason).
+// Above LOG_COMPILE_LEVEL the call is discarded at compile time, arguments included;
+// otherwise the arguments are only evaluated when the source's runtime level allows it
+#define LOG_AT(level, message, ...) \
+    do { \
+        if constexpr ((level) <= LOG_COMPILE_LEVEL) { \
+            if (::logBuffer.isEnabled((level), (message))) { \
+                ::logBuffer.log((level), (message), ##__VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+
+#define LOG_ERROR(message, ...) LOG_AT(LOG_LEVEL_ERROR, message, ##__VA_ARGS__)
+#define LOG_WARN(message, ...)  LOG_AT(LOG_LEVEL_WARN, message, ##__VA_ARGS__)
+#define LOG_INFO(message, ...)  LOG_AT(LOG_LEVEL_INFO, message, ##__VA_ARGS__)
+#define LOG_DEBUG(message, ...) LOG_AT(LOG_LEVEL_DEBUG, message, ##__VA_ARGS__)
+#define LOG_TRACE(message, ...) LOG_AT(LOG_LEVEL_TRACE, message, ##__VA_ARGS__)
+
 #endif // LOG_BUFFER_H
@@ -0,0 +1,72 @@
+#ifndef LOG_DRAIN_H
+#define LOG_DRAIN_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "log_buffer.h"
+
+// Copies the log to Serial from a low priority task, so logging never waits for the
+// UART or USB. Each pass writes only what the output can take without blocking
+// (availableForWrite()); a line that does not fit is finished on a later pass. If the
+// output falls so far behind that the log ring overwrites lines not yet printed, they are
+// skipped (drop oldest) and counted
+class LogDrain {
+public:
+    struct Stats {
+        uint32_t printed;    // Lines written
+        uint32_t dropped;    // Lines overwritten before they were written
+        uint32_t bytes;
+    };
+
+    LogDrain(LogBuffer& log, Print& out) : log(log), out(out), task(nullptr), printed(0), bytes(0) {
+        cursor = {1, 0, 0, 0, 0, 0};
+    }
+
+    // Lines logged before begin() are printed too, as long as they are still in the ring
+    void begin() {
+        xTaskCreate(taskEntry, "log_drain", LOG_DRAIN_TASK_STACK, this, LOG_DRAIN_TASK_PRIORITY, &task);
+    }
+
+    Stats getStats() const {
+        Stats stats = {printed, cursor.lost, bytes};
+        return stats;
+    }
+
+private:
+    static void taskEntry(void* param) {
+        LogDrain* self = static_cast<LogDrain*>(param);
+        for (;;) {
+            self->drain();
+            vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL));
+        }
+    }
+
+    void drain() {
+        uint8_t buffer[LOG_DRAIN_CHUNK];
+        cursor.end = log.getSequence();
+
+        for (;;) {
+            int space = out.availableForWrite();
+            if (space <= 0) {
+                return;
+            }
+            uint32_t before = cursor.next - cursor.lost;
+            size_t length = log.copy(cursor, buffer, min((size_t)space, sizeof(buffer)));
+            if (length == 0) {
+                return;
+            }
+            out.write(buffer, length);
+            bytes += length;
+            printed += cursor.next - cursor.lost - before;
+        }
+    }
+
+    LogBuffer& log;
+    Print& out;
+    TaskHandle_t task;
+    LogBuffer::Cursor cursor;   // Next line to print
+    uint32_t printed;
+    uint32_t bytes;
+};
+
+#endif // LOG_DRAIN_H
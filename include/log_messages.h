@@ -0,0 +1,147 @@
+#ifndef LOG_MESSAGES_H
+#define LOG_MESSAGES_H
+
+#include "arduino_compat.h"
+
+// Severity of a log message
+enum LogLevel : uint8_t {
+    LOG_LEVEL_ERROR = 1,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_TRACE
+};
+
+// Part of the system a log message comes from
+enum LogSource : uint8_t {
+    LOG_SOURCE_SYSTEM = 0,
+    LOG_SOURCE_SENSORS,
+    LOG_SOURCE_SAFETY,
+    LOG_SOURCE_CONTROL,
+    LOG_SOURCE_COMMANDS,
+    LOG_SOURCE_MQTT,
+    LOG_SOURCE_NETWORK,
+    LOG_SOURCE_WEB,
+    LOG_SOURCE_COUNT
+};
+
+// Every message the firmware logs: id, source and printf style format. The level is
+// given where it is logged (LOG_ERROR() ... LOG_TRACE() in log_buffer.h).
+// The log stores only the id and the arguments; the text is produced when it is read
+#define LOG_MESSAGES(X) \
+    X(MSG_SYSTEM_STARTED,            LOG_SOURCE_SYSTEM,   "System started") \
+    X(MSG_RESET_REASON,              LOG_SOURCE_SYSTEM,   "Reset reason: %s") \
+    X(MSG_ABNORMAL_RESET,            LOG_SOURCE_SYSTEM,   "ALERT! Restarted after %s") \
+    X(MSG_LOG_STORE_UNAVAILABLE,     LOG_SOURCE_SYSTEM,   "Log not saved to flash (LittleFS unavailable)") \
+    X(MSG_SENSORS_INITIALIZED,       LOG_SOURCE_SENSORS,  "Temperature sensors initialized") \
+    X(MSG_RELAYS_INITIALIZED,        LOG_SOURCE_SYSTEM,   "Relays initialized") \
+    X(MSG_AIR_INTAKE_INITIALIZED,    LOG_SOURCE_CONTROL,  "Air intake control initialized") \
+    X(MSG_SAFETY_STARTED,            LOG_SOURCE_SAFETY,   "Safety supervisor started") \
+    X(MSG_CONTROL_TASK_STARTED,      LOG_SOURCE_CONTROL,  "Control task started (%d ms period)") \
+    X(MSG_DISPLAY_INITIALIZED,       LOG_SOURCE_SYSTEM,   "Display initialized") \
+    X(MSG_WEB_SERVER_STARTED,        LOG_SOURCE_WEB,      "Web server started on port %d") \
+    X(MSG_SYSTEM_READY,              LOG_SOURCE_SYSTEM,   "System ready!") \
+    X(MSG_STATUS_JSON_OVERFLOW,      LOG_SOURCE_WEB,      "Status JSON larger than STATUS_JSON_SIZE, serving the last one that fit") \
+    X(MSG_SENSOR_RECOVERED,          LOG_SOURCE_SENSORS,  "Sensor %s recovered") \
+    X(MSG_SENSOR_FAULT,              LOG_SOURCE_SENSORS,  "ALERT! Sensor %s fault: %s") \
+    X(MSG_CRITICAL_TEMPERATURE,      LOG_SOURCE_SAFETY,   "ALERT! Critical water temperature: %.2f°C - Emergency mode activated") \
+    X(MSG_WATER_TEMPERATURE_UNKNOWN, LOG_SOURCE_SAFETY,   "ALERT! Boiler water temperature unknown (sensor fault) - Emergency mode activated") \
+    X(MSG_SAFETY_REACTION,           LOG_SOURCE_SAFETY,   "Safety outputs driven %u us after the first critical sample") \
+    X(MSG_WATER_TEMPERATURE_NORMAL,  LOG_SOURCE_SAFETY,   "Water temperature normalized: %.2f°C - Normal mode restored") \
+    X(MSG_AUTOTUNE_DONE,             LOG_SOURCE_CONTROL,  "PID auto-tuning completed after %d cycles: Ku=%.3f Tu=%.1fs -> Kp=%.3f Ki=%.3f Kd=%.3f") \
+    X(MSG_AUTOTUNE_FAILED,           LOG_SOURCE_CONTROL,  "PID auto-tuning failed to converge after %d cycles (spread %.0f%%) - Previous parameters kept") \
+    X(MSG_AUTOTUNE_SENSOR_FAULT,     LOG_SOURCE_CONTROL,  "PID auto-tuning canceled: burning sensor fault") \
+    X(MSG_TARGET_TEMPERATURE,        LOG_SOURCE_COMMANDS, "New target temperature%s: %.2f°C") \
+    X(MSG_SERVO_MIN,                 LOG_SOURCE_COMMANDS, "New servo minimum position: %d") \
+    X(MSG_SERVO_MAX,                 LOG_SOURCE_COMMANDS, "New servo maximum position: %d") \
+    X(MSG_AUTOTUNE_CANCELED,         LOG_SOURCE_COMMANDS, "PID auto-tuning canceled") \
+    X(MSG_AUTOTUNE_STARTED,          LOG_SOURCE_COMMANDS, "Starting PID auto-tuning. This may take several minutes...") \
+    X(MSG_RELAY_STATE,               LOG_SOURCE_COMMANDS, "%s state%s: %s") \
+    X(MSG_SENSOR_FILTER,             LOG_SOURCE_COMMANDS, "New sensor filter for %s: period %u ms, median %d, alpha %.2f") \
+    X(MSG_CALIBRATION,               LOG_SOURCE_COMMANDS, "New calibration for %s: gain %.4f, offset %.2f") \
+    X(MSG_CALIBRATION_RESET,         LOG_SOURCE_COMMANDS, "Calibration reset for %s") \
+    X(MSG_COMMAND_REJECTED,          LOG_SOURCE_COMMANDS, "Command %s rejected: %s") \
+    X(MSG_SETTING_REJECTED,          LOG_SOURCE_WEB,      "Setting %s rejected: %s") \
+    X(MSG_MQTT_RECEIVED,             LOG_SOURCE_MQTT,     "MQTT received: %s -> %s") \
+    X(MSG_MQTT_COMMAND_REJECTED,     LOG_SOURCE_MQTT,     "MQTT command %s rejected: %s") \
+    X(MSG_MQTT_CONNECTED,            LOG_SOURCE_MQTT,     "Home Assistant integration started (%u ms to connect)") \
+    X(MSG_MQTT_RESOLVE_FAILED,       LOG_SOURCE_MQTT,     "MQTT broker address not resolved") \
+    X(MSG_MQTT_CONNECTING,           LOG_SOURCE_MQTT,     "Connecting to MQTT...") \
+    X(MSG_MQTT_CONNECT_FAILED,       LOG_SOURCE_MQTT,     "MQTT connection failed, rc=%d") \
+    X(MSG_MQTT_SESSION,              LOG_SOURCE_MQTT,     "MQTT session established, subscribing") \
+    X(MSG_MQTT_DISCOVERY_FAILED,     LOG_SOURCE_MQTT,     "Home Assistant discovery of %s not sent, reconnecting") \
+    X(MSG_MQTT_READY,                LOG_SOURCE_MQTT,     "MQTT and Home Assistant integration completed") \
+    X(MSG_MQTT_LOST,                 LOG_SOURCE_MQTT,     "MQTT connection lost - Continuing without Home Assistant") \
+    X(MSG_FS_ERROR,                  LOG_SOURCE_NETWORK,  "Error initializing LittleFS") \
+    X(MSG_WIFI_RECONNECTING,         LOG_SOURCE_NETWORK,  "WiFi connection lost. Attempting to reconnect...") \
+    X(MSG_WIFI_CONNECTED,            LOG_SOURCE_NETWORK,  "Connected to WiFi, IP: %u.%u.%u.%u") \
+    X(MSG_WIFI_LOST,                 LOG_SOURCE_NETWORK,  "WiFi connection lost") \
+    X(MSG_WIFI_CONNECTING,           LOG_SOURCE_NETWORK,  "Starting WiFi connection...") \
+    X(MSG_WIFI_RETRY,                LOG_SOURCE_NETWORK,  "WiFi not connected yet, attempt %d") \
+    X(MSG_WIFI_GAVE_UP,              LOG_SOURCE_NETWORK,  "Failed to connect to WiFi after maximum attempts - Continuing without connectivity") \
+    X(MSG_OTA_CONFIGURED,            LOG_SOURCE_NETWORK,  "OTA configured") \
+    X(MSG_OTA_STARTED,               LOG_SOURCE_NETWORK,  "Starting OTA update: %s") \
+    X(MSG_OTA_PROGRESS,              LOG_SOURCE_NETWORK,  "OTA progress: %u%%") \
+    X(MSG_OTA_COMPLETED,             LOG_SOURCE_NETWORK,  "OTA update completed") \
+    X(MSG_OTA_ERROR,                 LOG_SOURCE_NETWORK,  "OTA error %u: %s")
+
+enum LogMessage : uint16_t {
+#define LOG_MESSAGE_ID(id, source, format) id,
+    LOG_MESSAGES(LOG_MESSAGE_ID)
+#undef LOG_MESSAGE_ID
+    MSG_COUNT
+};
+
+struct LogMessageInfo {
+    LogSource source;
+    const char* format;
+};
+
+inline const LogMessageInfo& logMessageInfo(uint16_t message) {
+    static const LogMessageInfo table[MSG_COUNT + 1] = {
+#define LOG_MESSAGE_INFO(id, source, format) {source, format},
+        LOG_MESSAGES(LOG_MESSAGE_INFO)
+#undef LOG_MESSAGE_INFO
+        {LOG_SOURCE_SYSTEM, "Unknown message"}
+    };
+    return table[message < MSG_COUNT ? message : MSG_COUNT];
+}
+
+inline const char* logLevelName(uint8_t level) {
+    switch (level) {
+        case LOG_LEVEL_ERROR: return "ERROR";
+        case LOG_LEVEL_WARN: return "WARN";
+        case LOG_LEVEL_INFO: return "INFO";
+        case LOG_LEVEL_DEBUG: return "DEBUG";
+        case LOG_LEVEL_TRACE: return "TRACE";
+        default: return "?";
+    }
+}
+
+inline const char* logSourceName(uint8_t source) {
+    static const char* const names[LOG_SOURCE_COUNT] = {
+        "system", "sensors", "safety", "control", "commands", "mqtt", "network", "web"
+    };
+    return source < LOG_SOURCE_COUNT ? names[source] : "unknown";
+}
+
+// Level from its name ("error" ... "trace", any case), 0 if unknown
+inline uint8_t logLevelFromName(const char* name) {
+    for (uint8_t level = LOG_LEVEL_ERROR; level <= LOG_LEVEL_TRACE; level++) {
+        if (strcasecmp(name, logLevelName(level)) == 0) {
+            return level;
+        }
+    }
+    return 0;
+}
+
+// Source from its name, LOG_SOURCE_COUNT if unknown
+inline uint8_t logSourceFromName(const char* name) {
+    uint8_t source = 0;
+    while (source < LOG_SOURCE_COUNT && strcmp(name, logSourceName(source)) != 0) {
+        source++;
+    }
+    return source;
+}
+
+#endif // LOG_MESSAGES_H
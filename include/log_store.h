@@ -0,0 +1,250 @@
+#ifndef LOG_STORE_H
+#define LOG_STORE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <atomic>
+#include "config.h"
+#include "log_buffer.h"
+
+// Copy of the log on LittleFS that survives resets (brownouts, watchdog, killswitch).
+// A low priority task follows the log and appends its lines to segment files
+// (LOG_STORE_DIR/<index>.log). Each boot continues the newest segment after a boot marker
+// line, and starts a new one only if it is full. To spare the flash, lines are
+// written in batches: once LOG_STORE_BATCH_ENTRIES are pending, when the oldest pending
+// line is LOG_STORE_FLUSH_INTERVAL old, or at once after an error message. A segment is
+// closed at LOG_STORE_SEGMENT_SIZE bytes and the oldest segments are deleted to keep
+// LOG_STORE_SEGMENTS. Nothing here runs in the control task or loop()
+class LogStore {
+public:
+    struct Segment {
+        uint32_t index;
+        uint32_t size;
+    };
+
+    struct Stats {
+        bool enabled;           // LittleFS available
+        uint32_t segment;       // Segment being written
+        uint32_t flushes;
+        uint32_t lines;         // Lines written since boot
+        uint32_t bytes;
+        uint32_t lost;          // Lines overwritten in RAM before they were written
+        uint32_t errors;        // Failed opens or short writes
+        uint32_t lastFlush;     // Duration of the last flush (us)
+        uint32_t maxFlush;
+    };
+
+    LogStore(LogBuffer& log) : log(log), task(nullptr), enabled(false), firstSegment(0), segment(0),
+                               segmentSize(0), waiting(false), pendingSince(0) {
+        cursor = {1, 0, 0, 0, 0, 0};
+        stats = {false, 0, 0, 0, 0, 0, 0, 0, 0};
+    }
+
+    // Call once LittleFS is mounted. Lines logged before are written too, as long as they
+    // are still in the RAM log
+    void begin() {
+        if (!LittleFS.exists(LOG_STORE_DIR) && !LittleFS.mkdir(LOG_STORE_DIR)) {
+            return;
+        }
+
+        // Find the segments of the previous boots
+        uint32_t newest = 0;
+        uint32_t newestSize = 0;
+        uint32_t oldest = UINT32_MAX;
+        File dir = LittleFS.open(LOG_STORE_DIR);
+        for (File file = dir.openNextFile(); file; file = dir.openNextFile()) {
+            uint32_t index;
+            if (parseIndex(file.name(), index)) {
+                if (index > newest) {
+                    newest = index;
+                    newestSize = file.size();
+                }
+                oldest = min(oldest, index);
+            }
+            file.close();
+        }
+        dir.close();
+
+        // Keep filling the newest segment while it has room
+        firstSegment = oldest == UINT32_MAX ? 1 : oldest;
+        if (newest > 0 && newestSize < LOG_STORE_SEGMENT_SIZE) {
+            segment = newest;
+            segmentSize = newestSize;
+        } else {
+            segment = newest + 1;
+            segmentSize = 0;
+        }
+        trim();
+        writeBootMarker();
+
+        enabled = true;
+        stats.enabled = true;
+        stats.segment = segment;
+        xTaskCreate(taskEntry, "log_store", LOG_STORE_TASK_STACK, this, LOG_STORE_TASK_PRIORITY, &task);
+    }
+
+    bool isEnabled() const {
+        return enabled;
+    }
+
+    // Segments on flash, oldest first. Returns how many were copied into segments.
+    // Called from the web server while the log_store task rotates and trims: the range is
+    // read once, and segments deleted meanwhile are skipped
+    int listSegments(Segment* segments, int maxSegments) {
+        uint32_t last = segment.load(std::memory_order_acquire);
+        uint32_t first = firstSegment.load(std::memory_order_acquire);
+        int count = 0;
+        for (uint32_t index = first; index <= last && count < maxSegments; index++) {
+            char path[32];
+            segmentPath(index, path, sizeof(path));
+            File file = LittleFS.open(path, "r");
+            if (!file) {
+                continue;
+            }
+            segments[count++] = {index, (uint32_t)file.size()};
+            file.close();
+        }
+        return count;
+    }
+
+    static void segmentPath(uint32_t index, char* path, size_t size) {
+        snprintf(path, size, "%s/%lu.log", LOG_STORE_DIR, (unsigned long)index);
+    }
+
+    Stats getStats() const {
+        return stats;
+    }
+
+private:
+    static void taskEntry(void* param) {
+        LogStore* self = static_cast<LogStore*>(param);
+        for (;;) {
+            self->check();
+            vTaskDelay(pdMS_TO_TICKS(LOG_STORE_CHECK_INTERVAL));
+        }
+    }
+
+    // Flush when a batch is complete, the oldest pending line is too old or after an alarm
+    void check() {
+        uint32_t sequence = log.getSequence();
+        uint32_t pending = sequence - (cursor.next - 1);
+        if (pending == 0) {
+            waiting = false;
+            return;
+        }
+
+        unsigned long now = millis();
+        if (!waiting) {
+            waiting = true;
+            pendingSince = now;
+        }
+        if (pending < LOG_STORE_BATCH_ENTRIES && now - pendingSince < LOG_STORE_FLUSH_INTERVAL &&
+            log.getAlarmSequence() < cursor.next) {
+            return;
+        }
+
+        cursor.end = sequence;
+        flush();
+        waiting = false;
+    }
+
+    // Append every pending line, rotating segments as they fill up
+    void flush() {
+        uint32_t start = micros();
+        uint8_t buffer[LOG_STORE_CHUNK];
+        char path[32];
+        segmentPath(segment, path, sizeof(path));
+        File file = LittleFS.open(path, "a");
+        if (!file) {
+            stats.errors++;
+            return;
+        }
+
+        size_t length;
+        uint32_t before = cursor.next - cursor.lost;
+        while ((length = log.copy(cursor, buffer, sizeof(buffer))) > 0) {
+            if (file.write(buffer, length) != length) {
+                stats.errors++;
+            }
+            segmentSize += length;
+            stats.bytes += length;
+
+            // Rotate between lines only, a split line stays in one segment
+            if (segmentSize >= LOG_STORE_SEGMENT_SIZE && cursor.offset == 0) {
+                file.close();
+                segment++;
+                segmentSize = 0;
+                stats.segment = segment;
+                trim();
+                segmentPath(segment, path, sizeof(path));
+                file = LittleFS.open(path, "a");
+                if (!file) {
+                    stats.errors++;
+                    break;
+                }
+            }
+        }
+        if (file) {
+            file.close();
+        }
+
+        stats.lines += cursor.next - cursor.lost - before;
+        stats.lost = cursor.lost;
+        stats.flushes++;
+        stats.lastFlush = micros() - start;
+        stats.maxFlush = max(stats.maxFlush, stats.lastFlush);
+    }
+
+    // Separates the lines of each boot inside a segment
+    void writeBootMarker() {
+        static const char marker[] = "----- boot -----\n";
+        char path[32];
+        segmentPath(segment, path, sizeof(path));
+        File file = LittleFS.open(path, "a");
+        if (!file) {
+            stats.errors++;
+            return;
+        }
+        size_t length = strlen(marker);
+        if (file.write((const uint8_t*)marker, length) != length) {
+            stats.errors++;
+        }
+        file.close();
+        segmentSize += length;
+        stats.bytes += length;
+    }
+
+    // Delete the oldest segments, keeping LOG_STORE_SEGMENTS including the current one
+    void trim() {
+        while (segment - firstSegment >= LOG_STORE_SEGMENTS) {
+            char path[32];
+            segmentPath(firstSegment, path, sizeof(path));
+            LittleFS.remove(path);
+            firstSegment++;
+        }
+    }
+
+    // "<index>.log", with or without the directory
+    static bool parseIndex(const char* name, uint32_t& index) {
+        const char* slash = strrchr(name, '/');
+        if (slash) {
+            name = slash + 1;
+        }
+        char* end;
+        index = strtoul(name, &end, 10);
+        return end != name && strcmp(end, ".log") == 0;
+    }
+
+    LogBuffer& log;
+    TaskHandle_t task;
+    bool enabled;
+    std::atomic<uint32_t> firstSegment;  // Oldest segment that may exist
+    std::atomic<uint32_t> segment;       // Segment being written
+    uint32_t segmentSize;
+    bool waiting;                  // Lines pending since pendingSince
+    unsigned long pendingSince;
+    LogBuffer::Cursor cursor;      // Next line to write
+    Stats stats;
+};
+
+#endif // LOG_STORE_H
@@ -0,0 +1,103 @@
+#ifndef LOOP_TIMING_H
+#define LOOP_TIMING_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Period jitter and overrun statistics of a fixed period loop.
+// wake() is called when a cycle starts and done() when its work is finished.
+// Jitter (deviation of the measured period from the nominal one) is kept in a
+// fixed histogram so the p99 can be reported without storing samples.
+class LoopTiming {
+public:
+    struct Stats {
+        uint32_t cycles;        // Cycles measured
+        uint32_t overruns;      // Cycles whose work took longer than the period
+        uint32_t minPeriod;     // Shortest measured period (us)
+        uint32_t maxPeriod;     // Longest measured period (us)
+        uint32_t p99Jitter;     // 99th percentile of |period - nominal| (us, LOOP_JITTER_BIN resolution)
+        uint32_t maxExecution;  // Longest work time of a cycle (us)
+    };
+
+    LoopTiming(uint32_t periodMs) : periodUs(periodMs * 1000UL) {
+        mux = portMUX_INITIALIZER_UNLOCKED;
+        reset();
+    }
+
+    void reset() {
+        portENTER_CRITICAL(&mux);
+        for (int i = 0; i < LOOP_JITTER_BINS; i++) {
+            histogram[i] = 0;
+        }
+        cycles = 0;
+        overruns = 0;
+        minPeriod = UINT32_MAX;
+        maxPeriod = 0;
+        maxExecution = 0;
+        lastWake = 0;
+        haveLastWake = false;
+        portEXIT_CRITICAL(&mux);
+    }
+
+    void wake(uint32_t nowUs) {
+        portENTER_CRITICAL(&mux);
+        if (haveLastWake) {
+            uint32_t period = nowUs - lastWake;
+            uint32_t jitter = period > periodUs ? period - periodUs : periodUs - period;
+            int bin = min((int)(jitter / LOOP_JITTER_BIN), LOOP_JITTER_BINS - 1);
+            histogram[bin]++;
+            cycles++;
+            if (period < minPeriod) minPeriod = period;
+            if (period > maxPeriod) maxPeriod = period;
+        }
+        lastWake = nowUs;
+        haveLastWake = true;
+        portEXIT_CRITICAL(&mux);
+    }
+
+    void done(uint32_t nowUs) {
+        portENTER_CRITICAL(&mux);
+        uint32_t execution = nowUs - lastWake;
+        if (execution > maxExecution) maxExecution = execution;
+        if (execution > periodUs) overruns++;
+        portEXIT_CRITICAL(&mux);
+    }
+
+    Stats getStats() {
+        Stats stats;
+        portENTER_CRITICAL(&mux);
+        stats.cycles = cycles;
+        stats.overruns = overruns;
+        stats.minPeriod = cycles ? minPeriod : 0;
+        stats.maxPeriod = maxPeriod;
+        stats.maxExecution = maxExecution;
+
+        // Upper edge of the bin holding the 99th percentile
+        uint32_t target = cycles - cycles / 100;
+        uint32_t count = 0;
+        stats.p99Jitter = 0;
+        for (int i = 0; i < LOOP_JITTER_BINS && cycles; i++) {
+            count += histogram[i];
+            if (count >= target) {
+                stats.p99Jitter = (i + 1) * LOOP_JITTER_BIN;
+                break;
+            }
+        }
+        portEXIT_CRITICAL(&mux);
+        return stats;
+    }
+
+private:
+    uint32_t periodUs;
+    uint32_t histogram[LOOP_JITTER_BINS];
+    uint32_t cycles;
+    uint32_t overruns;
+    uint32_t minPeriod;
+    uint32_t maxPeriod;
+    uint32_t maxExecution;
+    uint32_t lastWake;
+    bool haveLastWake;
+    portMUX_TYPE mux;
+};
+
+#endif // LOOP_TIMING_H
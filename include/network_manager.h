@@ -26,12 +26,12 @@ public:
         connectionAttempt = 0;
         lastWifiCheckTime = 0;
         wifiWasConnected = false;
+        mqttWasConnected = false;
         onWifiConnected = nullptr;
         onWifiDisconnected = nullptr;
     }
 
-    void begin(LogBuffer* logBufferPtr = nullptr, HomeAssistant* homeAssistantPtr = nullptr) {
-        logBuffer = logBufferPtr;
+    void begin(HomeAssistant* homeAssistantPtr = nullptr) {
         homeAssistant = homeAssistantPtr;
 
         // Configure WiFi in station mode
@@ -43,8 +43,12 @@ public:
 
         // Initialize LittleFS filesystem with our helper
         if (!FSHelper::initializeLittleFS()) {
-            Serial.println("Error initializing LittleFS");
-            if (logBuffer) logBuffer->log("Error initializing LittleFS");
+            LOG_ERROR(MSG_FS_ERROR);
+        }
+
+        // MQTT connects from update(); its offline queue may spill to LittleFS
+        if (homeAssistant) {
+            homeAssistant->begin();
         }
 
         // Configure and start ArduinoOTA
@@ -58,6 +62,12 @@ public:
             ArduinoOTA.handle();
         }
 
+        // Advance the MQTT connection (one non-blocking step per call)
+        if (homeAssistant) {
+            homeAssistant->loop();
+            checkMqttStateChanges();
+        }
+
         // Handle connection process if trying to connect
         if (wifiState == WIFI_CONNECTING) {
             handleWiFiConnection();
@@ -69,21 +79,12 @@ public:
 
             // Try to reconnect WiFi if connection was lost and not already trying to connect
             if (WiFi.status() != WL_CONNECTED && wifiState != WIFI_CONNECTED && wifiState != WIFI_CONNECTING) {
-                Serial.println("WiFi connection lost. Attempting to reconnect...");
-                if (logBuffer) logBuffer->log("WiFi connection lost. Attempting to reconnect...");
+                LOG_WARN(MSG_WIFI_RECONNECTING);
                 startWiFiConnection();
             }
 
             // Check for WiFi state changes
             checkWifiStateChanges(currentMillis);
-
-            // Try to reconnect MQTT if WiFi is connected but MQTT isn't
-            if (homeAssistant && wifiState == WIFI_CONNECTED && !homeAssistant->isMqttConnected()) {
-                homeAssistant->begin();
-                if (homeAssistant->isMqttConnected()) {
-                    if (logBuffer) logBuffer->log("Reconnected to MQTT");
-                }
-            }
         }
     }
 
@@ -145,39 +146,42 @@ public:
         connectionStartTime = millis();
         connectionAttempt = 0;
 
-        Serial.println("Starting WiFi connection...");
+        LOG_DEBUG(MSG_WIFI_CONNECTING);
         WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
     }
 
 private:
+    // Log MQTT connection changes (the connection itself is handled by HomeAssistant::loop())
+    void checkMqttStateChanges() {
+        bool connected = homeAssistant->isMqttConnected();
+        if (connected == mqttWasConnected) {
+            return;
+        }
+        mqttWasConnected = connected;
+
+        if (connected) {
+            LOG_INFO(MSG_MQTT_CONNECTED, homeAssistant->getStats().timeToConnect);
+        } else {
+            LOG_WARN(MSG_MQTT_LOST);
+        }
+    }
+
     void checkWifiStateChanges(unsigned long currentMillis) {
         // Check for WiFi connection state changes
         if (wifiState == WIFI_CONNECTED && !wifiWasConnected) {
             // WiFi just connected
             wifiWasConnected = true;
-            String ipAddress = getIP().toString();
-            Serial.println("Connected to WiFi, IP: " + ipAddress);
-            if (logBuffer) logBuffer->log("Connected to WiFi, IP: " + ipAddress);
+            IPAddress ip = getIP();
+            LOG_INFO(MSG_WIFI_CONNECTED, ip[0], ip[1], ip[2], ip[3]);
 
             // Call the connection callback if defined
             if (onWifiConnected) {
                 onWifiConnected();
             }
-
-            // Try to connect to MQTT
-            if (homeAssistant) {
-                homeAssistant->begin();
-                if (homeAssistant->isMqttConnected()) {
-                    if (logBuffer) logBuffer->log("Home Assistant integration started");
-                } else {
-                    if (logBuffer) logBuffer->log("Could not connect to MQTT - Continuing without Home Assistant");
-                }
-            }
         } else if (wifiState != WIFI_CONNECTED && wifiWasConnected) {
             // WiFi just disconnected
             wifiWasConnected = false;
-            Serial.println("WiFi connection lost");
-            if (logBuffer) logBuffer->log("WiFi connection lost");
+            LOG_WARN(MSG_WIFI_LOST);
 
             // Call the disconnection callback if defined
             if (onWifiDisconnected) {
@@ -190,13 +194,8 @@ private:
 
         // Check connection status
         if (WiFi.status() == WL_CONNECTED) {
-            // Connection successful
-            Serial.println();
-            Serial.print("Connected to WiFi, IP: ");
-            Serial.println(WiFi.localIP());
-
+            // Connection successful, logged by checkWifiStateChanges()
             wifiState = WIFI_CONNECTED;
-            Serial.println("OTA service started");
             return;
         }
 
@@ -206,14 +205,13 @@ private:
 
             if (connectionAttempt >= MAX_WIFI_ATTEMPTS) {
                 // Max attempts reached, move to disconnected state
-                Serial.println("\nFailed to connect to WiFi after maximum attempts");
-                Serial.println("System will continue without connectivity");
+                LOG_WARN(MSG_WIFI_GAVE_UP);
                 wifiState = WIFI_DISCONNECTED;
                 return;
             }
 
             // Try again
-            Serial.print(".");
+            LOG_TRACE(MSG_WIFI_RETRY, connectionAttempt);
             connectionStartTime = currentTime;
             WiFi.disconnect();
             WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
@@ -226,34 +224,35 @@ private:
         ArduinoOTA.setPassword(OTA_PASSWORD);
 
         ArduinoOTA.onStart([]() {
-            String type;
-            if (ArduinoOTA.getCommand() == U_FLASH) {
-                type = "sketch";
-            } else { // U_SPIFFS
-                type = "filesystem";
-            }
-            Serial.println("Starting OTA update: " + type);
+            // U_SPIFFS otherwise
+            LOG_INFO(MSG_OTA_STARTED, ArduinoOTA.getCommand() == U_FLASH ? "sketch" : "filesystem");
         });
 
         ArduinoOTA.onEnd([]() {
-            Serial.println("\nOTA update completed");
+            LOG_INFO(MSG_OTA_COMPLETED);
         });
 
         ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
-            Serial.printf("Progress: %u%%\r", (progress / (total / 100)));
+            LOG_TRACE(MSG_OTA_PROGRESS, progress / (total / 100));
         });
 
         ArduinoOTA.onError([](ota_error_t error) {
-            Serial.printf("Error OTA[%u]: ", error);
-            if (error == OTA_AUTH_ERROR) Serial.println("Auth Failed");
-            else if (error == OTA_BEGIN_ERROR) Serial.println("Begin Failed");
-            else if (error == OTA_CONNECT_ERROR) Serial.println("Connect Failed");
-            else if (error == OTA_RECEIVE_ERROR) Serial.println("Receive Failed");
-            else if (error == OTA_END_ERROR) Serial.println("End Failed");
+            LOG_ERROR(MSG_OTA_ERROR, (unsigned int)error, otaErrorName(error));
         });
 
         ArduinoOTA.begin();
-        Serial.println("OTA configured");
+        LOG_DEBUG(MSG_OTA_CONFIGURED);
+    }
+
+    static const char* otaErrorName(ota_error_t error) {
+        switch (error) {
+            case OTA_AUTH_ERROR: return "Auth Failed";
+            case OTA_BEGIN_ERROR: return "Begin Failed";
+            case OTA_CONNECT_ERROR: return "Connect Failed";
+            case OTA_RECEIVE_ERROR: return "Receive Failed";
+            case OTA_END_ERROR: return "End Failed";
+            default: return "Unknown";
+        }
     }
 
     WiFiState wifiState;
@@ -261,13 +260,13 @@ private:
     int connectionAttempt;
     unsigned long lastWifiCheckTime;
     bool wifiWasConnected;
+    bool mqttWasConnected;
 
     // Callbacks
     void (*onWifiConnected)();
     void (*onWifiDisconnected)();
 
     // References to other components
-    LogBuffer* logBuffer;
     HomeAssistant* homeAssistant;
 
     static const int MAX_WIFI_ATTEMPTS = 10; // Maximum number of connection attempts
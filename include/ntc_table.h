@@ -0,0 +1,105 @@
+#ifndef NTC_TABLE_H
+#define NTC_TABLE_H
+
+#include "arduino_compat.h"
+#include <limits>
+#include "config.h"
+
+// ADC code to temperature conversion for the 10k NTC thermistors.
+// The lookup table is generated at compile time from the same Steinhart-Hart
+// coefficients used by the runtime formula and lives in flash.
+namespace NtcTable {
+
+constexpr int ADC_MAX = 4095;
+
+// Steinhart-Hart constants for 10k NTC thermistor
+constexpr double C1 = 1.009249522e-03;
+constexpr double C2 = 2.378405444e-04;
+constexpr double C3 = 2.019202697e-07;
+
+// Natural logarithm usable in constant expressions (std::log is not constexpr)
+constexpr double constLog(double x) {
+    // Reduce to x = m * 2^k with m in [1, 2)
+    int k = 0;
+    while (x >= 2.0) { x /= 2.0; k++; }
+    while (x < 1.0) { x *= 2.0; k--; }
+
+    // ln(m) = 2 * atanh((m - 1) / (m + 1)), series converges fast for m in [1, 2)
+    double y = (x - 1.0) / (x + 1.0);
+    double y2 = y * y;
+    double term = y;
+    double sum = 0;
+    for (int n = 1; n < 40; n += 2) {
+        sum += term / n;
+        term *= y2;
+    }
+
+    return 2.0 * sum + k * 0.69314718055994530942;
+}
+
+// Steinhart-Hart in double precision, evaluated by the compiler
+constexpr float temperatureAt(int rawADC) {
+    if (rawADC <= 0 || rawADC >= ADC_MAX) {
+        return std::numeric_limits<float>::quiet_NaN();
+    }
+
+    double resistor = NTC_SERIES_RESISTOR / (((double)ADC_MAX / rawADC) - 1.0);
+    double logR = constLog(resistor);
+    return (float)(1.0 / (C1 + C2 * logR + C3 * logR * logR * logR) - 273.15);
+}
+
+struct Table {
+    float values[ADC_MAX + 1];
+};
+
+constexpr Table buildTable() {
+    Table table = {};
+    for (int code = 0; code <= ADC_MAX; code++) {
+        table.values[code] = temperatureAt(code);
+    }
+    return table;
+}
+
+// One entry per ADC code (16 KB of flash)
+inline constexpr Table TABLE = buildTable();
+
+// Runtime Steinhart-Hart formula (reference implementation)
+inline float steinhartHart(float rawADC) {
+    // Railed readings (open or shorted thermistor) would divide by zero
+    if (rawADC <= 0 || rawADC >= ADC_MAX) {
+        return NAN;
+    }
+
+    // Single precision copies of the constants
+    float c1 = C1, c2 = C2, c3 = C3;
+
+    // Thermistor resistance
+    float resistor = NTC_SERIES_RESISTOR / ((4095.0 / rawADC) - 1.0);
+
+    // Steinhart-Hart formula to convert resistance to temperature
+    float logR = log(resistor);
+    float temp = 1.0 / (c1 + c2 * logR + c3 * logR * logR * logR);
+
+    // Convert from Kelvin to Celsius
+    return temp - 273.15;
+}
+
+// Table lookup, linear interpolation between adjacent codes for filtered (fractional) readings
+inline float lookup(float rawADC) {
+    if (!(rawADC > 0 && rawADC < ADC_MAX)) {
+        return NAN;
+    }
+
+    int index = (int)rawADC;
+    float fraction = rawADC - index;
+    float low = TABLE.values[index];
+    if (fraction == 0) {
+        return low;
+    }
+
+    return low + (TABLE.values[index + 1] - low) * fraction;
+}
+
+} // namespace NtcTable
+
+#endif // NTC_TABLE_H
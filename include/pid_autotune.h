@@ -1,8 +1,16 @@
 #ifndef PID_AUTOTUNE_H
 #define PID_AUTOTUNE_H
 
-#include <Arduino.h>
-
+#include "arduino_compat.h"
+#include <CircularBuffer.hpp>
+#include "config.h"
+
+// Åström–Hägglund relay auto-tuner.
+// The output is switched between bias + d and bias - d whenever the input leaves
+// the hysteresis band around the setpoint. The extremes reached in each half cycle
+// give the oscillation amplitude and the switch times give the period; once the
+// last PID_AUTOTUNE_CYCLES cycles agree within PID_AUTOTUNE_TOLERANCE, the ultimate
+// gain Ku and period Tu are averaged and converted to PID gains (Ziegler-Nichols).
 class PIDAutoTune {
 public:
     enum ControlType {
@@ -11,214 +19,285 @@ public:
         P_TYPE = 2
     };
 
+    enum State {
+        STATE_IDLE = 0,
+        STATE_APPROACH,   // Waiting for the input to cross the setpoint for the first time
+        STATE_RELAY,      // Oscillating and measuring cycles
+        STATE_DONE,       // Converged, gains available
+        STATE_FAILED,     // No convergence within PID_AUTOTUNE_MAX_CYCLES or timeout
+        STATE_CANCELLED
+    };
+
+    // Progress information for the web API
+    struct Status {
+        State state;
+        int cycles;           // Complete oscillation cycles measured
+        float ku;             // Current ultimate gain estimate (0 until first cycle)
+        float tu;             // Current ultimate period estimate in seconds
+        float amplitude;      // Average oscillation amplitude (half peak to peak, Celsius)
+        float spread;         // Largest relative deviation between averaged cycles
+        unsigned long elapsed;  // Time since start (ms)
+    };
+
     PIDAutoTune() {
         reset();
     }
 
-    // Initialize auto-tuning
-    void init(double* input, double* output, double setpoint, double outputStep, double noiseband, ControlType controlType) {
-        _input = input;
-        _output = output;
+    // Configure the relay. outputStep is the peak to peak swing around the current output
+    void init(float setpoint, float currentOutput, float outputStep, float hysteresis, ControlType controlType) {
+        reset();
         _setpoint = setpoint;
-        _outputStep = outputStep;
-        _noiseband = noiseband;
+        _hysteresis = hysteresis;
         _controlType = controlType;
 
-        // Initial values
-        _state = 0;
-        _lastTime = millis();
-        _peak1 = 0;
-        _peak2 = 0;
-        _lastInputs[0] = *_input;
-        _peakType = 0;
-        _peakCount = 0;
+        _outputHigh = constrain(currentOutput + outputStep / 2, 0.0f, 100.0f);
+        _outputLow = constrain(currentOutput - outputStep / 2, 0.0f, 100.0f);
         _initialized = true;
-        _running = false;
     }
 
-    // Start auto-tuning
-    void start() {
-        if (_initialized) {
-            _peak1 = 0;
-            _peak2 = 0;
-            _peakType = 0;
-            _peakCount = 0;
-            _running = true;
-            _state = 0;
-            _lastTime = millis();
+    void start(unsigned long now) {
+        if (!_initialized) return;
+
+        _cycles.clear();
+        _state = STATE_APPROACH;
+        _startTime = now;
+        _relayHigh = false;
+        _output = _outputLow;
+    }
+
+    void cancel(unsigned long now) {
+        if (isRunning()) {
+            _state = STATE_CANCELLED;
+            _endTime = now;
         }
     }
 
-    // Stop auto-tuning
-    void cancel() {
-        _running = false;
+    // Feed one input sample. Returns true when the auto-tuning has finished (done or failed)
+    bool compute(float input, unsigned long now) {
+        if (!isRunning()) return false;
+
+        if (now - _startTime > PID_AUTOTUNE_TIMEOUT) {
+            _state = STATE_FAILED;
+            _endTime = now;
+            return true;
+        }
+
+        // Track the extremes of the current half cycle (O(1) per sample)
+        if (input > _halfCycleMax) _halfCycleMax = input;
+        if (input < _halfCycleMin) _halfCycleMin = input;
+
+        // Relay with hysteresis
+        if (!_relayHigh && input < _setpoint - _hysteresis) {
+            switchRelay(true, now);
+        } else if (_relayHigh && input > _setpoint + _hysteresis) {
+            switchRelay(false, now);
+        } else if (_state == STATE_APPROACH && !_relayHigh && input <= _setpoint) {
+            // Start below the setpoint: drive up to get the first crossing
+            switchRelay(true, now);
+        }
+
+        return _state == STATE_DONE || _state == STATE_FAILED;
     }
 
-    // Run one auto-tuning cycle
-    bool compute() {
-        if (!_running) return false;
+    float getOutput() const { return _output; }
 
-        unsigned long now = millis();
-        if (now - _lastTime < 500) return false;  // Update every 500ms
+    // Get calculated parameters
+    float getKp() const { return _kp; }
+    float getKi() const { return _ki; }
+    float getKd() const { return _kd; }
 
-        _lastTime = now;
+    // Check if auto-tuning is running
+    bool isRunning() const { return _state == STATE_APPROACH || _state == STATE_RELAY; }
+
+    State getState() const { return _state; }
+
+    Status getStatus(unsigned long now) const {
+        Status status;
+        status.state = _state;
+        status.cycles = _cycleCount;
+        status.ku = _ku;
+        status.tu = _tu;
+        status.amplitude = _amplitude;
+        status.spread = _spread;
+        status.elapsed = (_state == STATE_IDLE) ? 0 : (isRunning() ? now : _endTime) - _startTime;
+        return status;
+    }
 
-        // Read the current input value
-        double refVal = *_input;
+    static const char* stateName(State state) {
+        switch (state) {
+            case STATE_IDLE: return "idle";
+            case STATE_APPROACH: return "approach";
+            case STATE_RELAY: return "relay";
+            case STATE_DONE: return "done";
+            case STATE_FAILED: return "failed";
+            case STATE_CANCELLED: return "cancelled";
+            default: return "unknown";
+        }
+    }
 
-        // Check if we are within the noise band
-        if (_state == 0) {
-            // Waiting for the signal to stabilize
-            *_output = _setpoint < refVal ? 0 : _outputStep;
+private:
+    // One measured oscillation cycle
+    struct Cycle {
+        float amplitude;  // Half peak to peak (Celsius)
+        float period;     // Seconds
+    };
 
-            // If we are within the noise band, move to the next state
-            if (abs(refVal - _setpoint) < _noiseband) {
-                _state = 1;
-                // Apply output step in the opposite direction
-                *_output = _setpoint < refVal ? _outputStep : 0;
+    void switchRelay(bool high, unsigned long now) {
+        // Because of the process lag the input keeps moving after each switch, so the
+        // peak is reached while the output is low and the trough while it is high
+        if (high) {
+            // Rising switch: the low output half cycle just ended, its maximum is a peak
+            _peak = _halfCycleMax;
+            _havePeak = true;
+        } else {
+            // Falling switch: the high output half cycle ended, its minimum is a trough.
+            // A full cycle is complete every falling switch after the first one
+            _trough = _halfCycleMin;
+            if (_havePeak && _haveFallingSwitch) {
+                recordCycle((_peak - _trough) / 2, (now - _lastFallingSwitch) / 1000.0f, now);
             }
+            _lastFallingSwitch = now;
+            _haveFallingSwitch = true;
         }
-        else {
-            // Look for peaks and valleys
 
-            // Shift previous values
-            for (int i = 9; i >= 1; i--) {
-                _lastInputs[i] = _lastInputs[i - 1];
-            }
-            _lastInputs[0] = refVal;
+        if (_state == STATE_APPROACH && !high) {
+            // First crossing above the setpoint starts the measured oscillation
+            _state = STATE_RELAY;
+        }
 
-            // Check if we have a peak or valley
-            int isMax = 1;
-            int isMin = 1;
+        _relayHigh = high;
+        _output = high ? _outputHigh : _outputLow;
+        _halfCycleMax = -1e9;
+        _halfCycleMin = 1e9;
+    }
 
-            for (int i = 1; i < 10; i++) {
-                if (_lastInputs[0] < _lastInputs[i]) isMax = 0;
-                if (_lastInputs[0] > _lastInputs[i]) isMin = 0;
-            }
+    void recordCycle(float amplitude, float period, unsigned long now) {
+        _cycleCount++;
 
-            // If we have a peak or valley, record it
-            if (isMax) {
-                if (_peakType == -1) {
-                    _peakCount++;
-                    _peak2 = _peak1;
-                    _peak1 = refVal;
-                }
-                _peakType = 1;
-            }
-            else if (isMin) {
-                if (_peakType == 1) {
-                    _peakCount++;
-                    _peak2 = _peak1;
-                    _peak1 = refVal;
-                }
-                _peakType = -1;
-            }
+        // The first cycle still carries the approach transient
+        if (_cycleCount == 1) return;
 
-            // If we have enough peaks, calculate PID parameters
-            if (_peakCount >= 4) {
-                // Calculate Ku and Tu values
-                double Ku = 4.0 * _outputStep / ((0.5 * (_peak1 - _peak2)) * 3.14159);
-                double Tu = (double)(now - _peaks[0]) / 1000.0;
-
-                // Calculate PID parameters using Ziegler-Nichols
-                if (_controlType == PID_TYPE) {
-                    _kp = 0.6 * Ku;
-                    _ki = 1.2 * Ku / Tu;
-                    _kd = 0.075 * Ku * Tu;
-                }
-                else if (_controlType == PI_TYPE) {
-                    _kp = 0.45 * Ku;
-                    _ki = 0.54 * Ku / Tu;
-                    _kd = 0;
-                }
-                else {  // P_TYPE
-                    _kp = 0.5 * Ku;
-                    _ki = 0;
-                    _kd = 0;
-                }
-
-                _running = false;
-                return true;  // Auto-tuning complete
-            }
-            else {
-                // Change output based on PID direction
-                if (refVal > _setpoint + _noiseband && *_output > 0) {
-                    *_output = 0;
-                }
-                else if (refVal < _setpoint - _noiseband && *_output < _outputStep) {
-                    *_output = _outputStep;
-                }
-
-                // Record peak times
-                if (_peakCount > 0 && _peakCount < 4) {
-                    _peaks[_peakCount - 1] = now;
-                }
-            }
+        Cycle cycle = {amplitude, period};
+        _cycles.push(cycle);
+
+        // Average the stored cycles and measure how far apart they are
+        float sumAmplitude = 0;
+        float sumPeriod = 0;
+        for (int i = 0; i < _cycles.size(); i++) {
+            sumAmplitude += _cycles[i].amplitude;
+            sumPeriod += _cycles[i].period;
         }
+        float meanAmplitude = sumAmplitude / _cycles.size();
+        float meanPeriod = sumPeriod / _cycles.size();
 
-        return false;  // Auto-tuning in progress
-    }
+        float spread = 0;
+        for (int i = 0; i < _cycles.size(); i++) {
+            spread = max(spread, (float)fabs(_cycles[i].amplitude - meanAmplitude) / meanAmplitude);
+            spread = max(spread, (float)fabs(_cycles[i].period - meanPeriod) / meanPeriod);
+        }
 
-    // Get calculated parameters
-    double getKp() const { return _kp; }
-    double getKi() const { return _ki; }
-    double getKd() const { return _kd; }
+        // Describing function of a relay with hysteresis: Ku = 4d / (pi * sqrt(a^2 - e^2))
+        float d = (_outputHigh - _outputLow) / 2;
+        float effective = meanAmplitude * meanAmplitude - _hysteresis * _hysteresis;
+        if (effective <= 0) effective = meanAmplitude * meanAmplitude;
+
+        _amplitude = meanAmplitude;
+        _spread = spread;
+        _ku = 4.0f * d / (3.14159f * sqrtf(effective));
+        _tu = meanPeriod;
+
+        if (_cycles.isFull() && spread <= PID_AUTOTUNE_TOLERANCE) {
+            computeGains();
+            _state = STATE_DONE;
+            _endTime = now;
+        } else if (_cycleCount >= PID_AUTOTUNE_MAX_CYCLES) {
+            _state = STATE_FAILED;
+            _endTime = now;
+        }
+    }
 
-    // Check if auto-tuning is running
-    bool isRunning() const { return _running; }
+    // Ziegler-Nichols from the averaged Ku and Tu
+    void computeGains() {
+        if (_controlType == PID_TYPE) {
+            _kp = 0.6f * _ku;
+            _ki = 1.2f * _ku / _tu;
+            _kd = 0.075f * _ku * _tu;
+        }
+        else if (_controlType == PI_TYPE) {
+            _kp = 0.45f * _ku;
+            _ki = 0.54f * _ku / _tu;
+            _kd = 0;
+        }
+        else {  // P_TYPE
+            _kp = 0.5f * _ku;
+            _ki = 0;
+            _kd = 0;
+        }
+    }
 
-private:
     void reset() {
-        _input = NULL;
-        _output = NULL;
         _setpoint = 0;
-        _outputStep = 10;
-        _noiseband = 0.5;
+        _hysteresis = 0.5f;
+        _outputHigh = 0;
+        _outputLow = 0;
+        _output = 0;
         _controlType = PI_TYPE;
-        _state = 0;
-        _peakType = 0;
-        _peakCount = 0;
+        _state = STATE_IDLE;
         _initialized = false;
-        _running = false;
+        _relayHigh = false;
+        _startTime = 0;
+        _endTime = 0;
+        _lastFallingSwitch = 0;
+        _haveFallingSwitch = false;
+        _halfCycleMax = -1e9;
+        _halfCycleMin = 1e9;
+        _peak = 0;
+        _trough = 0;
+        _havePeak = false;
+        _cycleCount = 0;
+        _ku = _tu = _amplitude = _spread = 0;
         _kp = _ki = _kd = 0;
-
-        for (int i = 0; i < 10; i++) {
-            _lastInputs[i] = 0;
-        }
-
-        for (int i = 0; i < 4; i++) {
-            _peaks[i] = 0;
-        }
+        _cycles.clear();
     }
 
-    // Pointers to PID variables
-    double* _input;
-    double* _output;
-
     // Configuration parameters
-    double _setpoint;
-    double _outputStep;
-    double _noiseband;
+    float _setpoint;
+    float _hysteresis;
+    float _outputHigh;
+    float _outputLow;
     ControlType _controlType;
 
-    // Internal variables for the algorithm
-    int _state;
-    int _peakType;
-    int _peakCount;
-    unsigned long _lastTime;
-    unsigned long _peaks[4];
-    double _lastInputs[10];
-    double _peak1;
-    double _peak2;
+    // Relay and extrema detector
+    float _output;
+    bool _relayHigh;
+    float _halfCycleMax;
+    float _halfCycleMin;
+    float _peak;
+    float _trough;
+    bool _havePeak;
+    unsigned long _startTime;
+    unsigned long _endTime;
+    unsigned long _lastFallingSwitch;
+    bool _haveFallingSwitch;
+
+    // Last measured cycles used for the average
+    CircularBuffer<Cycle, PID_AUTOTUNE_CYCLES> _cycles;
+    int _cycleCount;
+
+    // Estimates
+    float _ku;
+    float _tu;
+    float _amplitude;
+    float _spread;
 
     // Calculated PID parameters
-    double _kp;
-    double _ki;
-    double _kd;
+    float _kp;
+    float _ki;
+    float _kd;
 
     // State
+    State _state;
     bool _initialized;
-    bool _running;
 };
 
-#endif // PID_AUTOTUNE_H
\ No newline at end of file
+#endif // PID_AUTOTUNE_H
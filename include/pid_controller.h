@@ -0,0 +1,135 @@
+#ifndef PID_CONTROLLER_H
+#define PID_CONTROLLER_H
+
+#include "arduino_compat.h"
+#include "config.h"
+#include "fixed_point.h"
+
+// PID controller with the same behaviour as br3ttb's PID_v1 (proportional on
+// error, derivative on measurement, integral clamping, bumpless switch to
+// automatic), templated on the numeric type so it can run in float or in
+// Q16.16 fixed point instead of soft-float doubles.
+// Inputs, outputs and tunings are exchanged as float; only the control law
+// itself runs in T.
+template <typename T>
+class PIDController {
+public:
+    enum Mode {
+        MANUAL = 0,
+        AUTOMATIC = 1
+    };
+
+    PIDController(float kp, float ki, float kd)
+        : dispKp(0), dispKi(0), dispKd(0), output(0), outputSum(0), lastInput(0), outMin(0), outMax(255),
+          sampleTime(100), lastTime(0), firstCompute(true), mode(MANUAL) {
+        setTunings(kp, ki, kd);
+    }
+
+    // Run one step if the sample time has elapsed. Returns true if a new output was computed
+    bool compute(float inputValue, float setpointValue, unsigned long now) {
+        if (mode != AUTOMATIC) return false;
+        if (!firstCompute && now - lastTime < sampleTime) return false;
+
+        T input(inputValue);
+        T error = T(setpointValue) - input;
+        T dInput = input - lastInput;
+
+        // Integral term with anti-windup clamping
+        outputSum += ki * error;
+        outputSum = clamp(outputSum);
+
+        // Proportional on error, derivative on measurement (no derivative kick)
+        output = clamp(kp * error + outputSum - kd * dInput);
+
+        lastInput = input;
+        lastTime = now;
+        firstCompute = false;
+        return true;
+    }
+
+    void setTunings(float newKp, float newKi, float newKd) {
+        if (newKp < 0 || newKi < 0 || newKd < 0) return;
+
+        dispKp = newKp;
+        dispKi = newKi;
+        dispKd = newKd;
+
+        // Fold the sample time into the gains so compute() needs no division
+        float sampleTimeSec = sampleTime / 1000.0f;
+        kp = T(newKp);
+        ki = T(newKi * sampleTimeSec);
+        kd = T(newKd / sampleTimeSec);
+    }
+
+    void setSampleTime(unsigned long newSampleTime) {
+        if (newSampleTime == 0) return;
+        sampleTime = newSampleTime;
+        setTunings(dispKp, dispKi, dispKd);
+    }
+
+    void setOutputLimits(float min, float max) {
+        if (min >= max) return;
+        outMin = T(min);
+        outMax = T(max);
+
+        if (mode == AUTOMATIC) {
+            output = clamp(output);
+            outputSum = clamp(outputSum);
+        }
+    }
+
+    // Switching from manual to automatic starts from the current output (bumpless transfer)
+    void setMode(Mode newMode, float currentInput, float currentOutput) {
+        if (newMode == AUTOMATIC && mode == MANUAL) {
+            outputSum = clamp(T(currentOutput));
+            output = outputSum;
+            lastInput = T(currentInput);
+            firstCompute = true;
+        }
+        mode = newMode;
+    }
+
+    Mode getMode() const { return mode; }
+    float getOutput() const { return toFloat(output); }
+    float getKp() const { return dispKp; }
+    float getKi() const { return dispKi; }
+    float getKd() const { return dispKd; }
+
+private:
+    T clamp(T value) const {
+        if (value > outMax) return outMax;
+        if (value < outMin) return outMin;
+        return value;
+    }
+
+    // Working gains (ki and kd scaled by the sample time)
+    T kp;
+    T ki;
+    T kd;
+
+    // Gains as entered by the user
+    float dispKp;
+    float dispKi;
+    float dispKd;
+
+    T output;
+    T outputSum;
+    T lastInput;
+    T outMin;
+    T outMax;
+
+    unsigned long sampleTime;
+    unsigned long lastTime;
+    bool firstCompute;
+    Mode mode;
+};
+
+// Numeric type of the air intake PID. The ESP32-S2 has no FPU, so both options
+// are far cheaper than the doubles used by PID_v1
+#if PID_USE_FIXED_POINT
+typedef PIDController<Fixed16> AirIntakePID;
+#else
+typedef PIDController<float> AirIntakePID;
+#endif
+
+#endif // PID_CONTROLLER_H
@@ -7,31 +7,77 @@
 // Clase para un relay individual
 class Relay {
 public:
-    Relay(uint8_t pin, const String& name) :
-        pin(pin), name(name), state(false) {}
+    Relay(uint8_t pin, const char* name) :
+        pin(pin), name(name), state(false), requested(false), forced(false), mutex(nullptr) {}
 
     void begin() {
+        // Written by the control task and the safety supervisor. A mutex, not a spinlock:
+        // digitalWrite() is a driver call and must not run with interrupts masked. With
+        // priority inheritance the safety task waits at most for the write in progress
+        mutex = xSemaphoreCreateMutex();
         pinMode(pin, OUTPUT);
         setState(false); // Iniciar apagado
     }
 
+    // While the relay is forced the request is only remembered, the output keeps the forced state
     void setState(bool newState) {
-        digitalWrite(pin, newState ? HIGH : LOW);
-        state = newState;
+        lock();
+        requested = newState;
+        if (!forced) {
+            write(newState);
+        }
+        unlock();
+    }
+
+    // Take over the output (safety supervisor). Normal requests are ignored until release()
+    void force(bool newState) {
+        lock();
+        forced = true;
+        write(newState);
+        unlock();
+    }
+
+    // Give the output back, restoring the last normal request
+    void release() {
+        lock();
+        forced = false;
+        write(requested);
+        unlock();
+    }
+
+    bool isForced() const {
+        return forced;
     }
 
+    // Actual output state
     bool getState() const {
         return state;
     }
 
-    String getName() const {
+    const char* getName() const {
         return name;
     }
 
 private:
+    void write(bool newState) {
+        digitalWrite(pin, newState ? HIGH : LOW);
+        state = newState;
+    }
+
+    void lock() {
+        if (mutex) xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+
+    void unlock() {
+        if (mutex) xSemaphoreGive(mutex);
+    }
+
     uint8_t pin;
-    String name;
-    bool state;
+    const char* name;   // String literal, kept for the relay's lifetime
+    volatile bool state;
+    bool requested;
+    volatile bool forced;
+    SemaphoreHandle_t mutex;
 };
 
 #endif // RELAY_H
\ No newline at end of file
@@ -0,0 +1,184 @@
+#ifndef SAFETY_SUPERVISOR_H
+#define SAFETY_SUPERVISOR_H
+
+#include <Arduino.h>
+#include <esp_task_wdt.h>
+#include "config.h"
+#include "temperature_sensors.h"
+#include "relay.h"
+#include "air_intake.h"
+
+// Independent overheat protection.
+// Runs in the highest priority application task, reads the boiler water NTC directly every
+// SAFETY_SAMPLE_INTERVAL and, on a critical temperature or a broken sensor, forces the pumps
+// and fans on and the air intake closed. While tripped, requests from the control loop,
+// MQTT or the web API cannot change those outputs. The task is registered with the
+// task watchdog, so a stalled supervisor is reported by the system.
+class SafetySupervisor {
+public:
+    enum Reason {
+        REASON_NONE = 0,
+        REASON_CRITICAL_TEMP,   // Boiler water at or above BOILER_WATER_CRITICAL_TEMP
+        REASON_SENSOR_FAULT,    // Boiler water NTC open or shorted
+        REASON_EXTERNAL_FAULT   // Fault reported by the control loop (filtered sensor health)
+    };
+
+    // Reaction times in microseconds
+    struct Stats {
+        uint32_t trips;
+        uint32_t lastLatency;    // Trip confirmed -> outputs driven
+        uint32_t maxLatency;
+        uint32_t lastReaction;   // First sample over the limit -> outputs driven (includes debounce)
+        uint32_t maxReaction;
+    };
+
+    SafetySupervisor(TemperatureSensors& sensors, Relay& boilerPump, Relay& heatingPump, Relay& fans, AirIntake& airIntake)
+        : sensors(sensors), boilerPump(boilerPump), heatingPump(heatingPump), fans(fans), airIntake(airIntake),
+          task(nullptr), active(false), reason(REASON_NONE), externalFault(false), temperature(NAN),
+          tripSamples(0), clearSamples(0), firstExceed(0) {
+        lock = portMUX_INITIALIZER_UNLOCKED;
+        stats = {0, 0, 0, 0, 0};
+    }
+
+    // Start after the sensors, relays and air intake have been initialized
+    void begin() {
+        xTaskCreate(taskEntry, "safety", SAFETY_TASK_STACK, this, SAFETY_TASK_PRIORITY, &task);
+    }
+
+    bool isActive() const {
+        return active;
+    }
+
+    Reason getReason() const {
+        return reason;
+    }
+
+    // Last direct boiler water reading
+    float getTemperature() const {
+        return temperature;
+    }
+
+    // Fault detected elsewhere (e.g. rate or stuck checks on the filtered readings)
+    void setExternalFault(bool fault) {
+        externalFault = fault;
+    }
+
+    Stats getStats() {
+        portENTER_CRITICAL(&lock);
+        Stats copy = stats;
+        portEXIT_CRITICAL(&lock);
+        return copy;
+    }
+
+    static const char* reasonName(Reason reason) {
+        switch (reason) {
+            case REASON_NONE: return "none";
+            case REASON_CRITICAL_TEMP: return "critical_temp";
+            case REASON_SENSOR_FAULT: return "sensor_fault";
+            case REASON_EXTERNAL_FAULT: return "external_fault";
+            default: return "unknown";
+        }
+    }
+
+private:
+    static void taskEntry(void* param) {
+        SafetySupervisor* self = static_cast<SafetySupervisor*>(param);
+        TickType_t lastWake = xTaskGetTickCount();
+
+        esp_task_wdt_add(nullptr);
+
+        for (;;) {
+            self->check();
+            esp_task_wdt_reset();
+            vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SAFETY_SAMPLE_INTERVAL));
+        }
+    }
+
+    void check() {
+        uint32_t sampleTime = micros();
+        uint16_t raw;
+        float reading = sensors.readDirect(SENSOR_BOILER_WATER, raw);
+        temperature = reading;
+
+        bool sensorFault = raw >= SENSOR_OPEN_CODE || raw <= SENSOR_SHORT_CODE || isnan(reading);
+        Reason current = sensorFault ? REASON_SENSOR_FAULT :
+                         reading >= BOILER_WATER_CRITICAL_TEMP ? REASON_CRITICAL_TEMP :
+                         externalFault ? REASON_EXTERNAL_FAULT : REASON_NONE;
+
+        if (!active) {
+            // Entry: SAFETY_TRIP_SAMPLES consecutive samples over the limit (rejects single spikes)
+            if (current == REASON_NONE) {
+                tripSamples = 0;
+                return;
+            }
+            if (tripSamples == 0) {
+                firstExceed = sampleTime;
+            }
+            if (++tripSamples >= SAFETY_TRIP_SAMPLES) {
+                trip(current, sampleTime);
+            }
+        } else {
+            // Exit: below the limit minus SAFETY_HYSTERESIS for SAFETY_CLEAR_SAMPLES samples
+            bool clear = !sensorFault && !externalFault && reading < BOILER_WATER_CRITICAL_TEMP - SAFETY_HYSTERESIS;
+            if (!clear) {
+                clearSamples = 0;
+                return;
+            }
+            if (++clearSamples >= SAFETY_CLEAR_SAMPLES) {
+                release();
+            }
+        }
+    }
+
+    void trip(Reason tripReason, uint32_t detected) {
+        // Evacuate heat and starve the fire
+        boilerPump.force(true);
+        heatingPump.force(true);
+        fans.force(true);
+        airIntake.forcePosition(0);
+        uint32_t actuated = micros();
+
+        reason = tripReason;
+        active = true;
+        tripSamples = 0;
+        clearSamples = 0;
+
+        portENTER_CRITICAL(&lock);
+        stats.trips++;
+        stats.lastLatency = actuated - detected;
+        stats.maxLatency = max(stats.maxLatency, stats.lastLatency);
+        stats.lastReaction = actuated - firstExceed;
+        stats.maxReaction = max(stats.maxReaction, stats.lastReaction);
+        portEXIT_CRITICAL(&lock);
+    }
+
+    void release() {
+        boilerPump.release();
+        heatingPump.release();
+        fans.release();
+        airIntake.releasePosition();
+
+        active = false;
+        reason = REASON_NONE;
+        clearSamples = 0;
+    }
+
+    TemperatureSensors& sensors;
+    Relay& boilerPump;
+    Relay& heatingPump;
+    Relay& fans;
+    AirIntake& airIntake;
+
+    TaskHandle_t task;
+    volatile bool active;
+    volatile Reason reason;
+    volatile bool externalFault;
+    volatile float temperature;
+    int tripSamples;
+    int clearSamples;
+    uint32_t firstExceed;
+    Stats stats;
+    portMUX_TYPE lock;
+};
+
+#endif // SAFETY_SUPERVISOR_H
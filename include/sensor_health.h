@@ -0,0 +1,132 @@
+#ifndef SENSOR_HEALTH_H
+#define SENSOR_HEALTH_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Plausibility checks for one NTC channel, evaluated on every background sample.
+// A fault is raised after SENSOR_FAULT_SAMPLES consecutive bad samples and only
+// cleared after SENSOR_FAULT_CLEAR_TIME ms of good readings.
+class SensorHealth {
+public:
+    enum State {
+        HEALTH_OK = 0,
+        HEALTH_NO_DATA,  // Nothing sampled yet
+        HEALTH_OPEN,     // Reading stuck at the top rail (thermistor disconnected)
+        HEALTH_SHORT,    // Reading stuck at the bottom rail (thermistor shorted)
+        HEALTH_RATE,     // Temperature changing faster than physically possible
+        HEALTH_STUCK     // Raw code frozen (ADC or wiring problem)
+    };
+
+    SensorHealth() {
+        reset();
+    }
+
+    void reset() {
+        state = HEALTH_NO_DATA;
+        badSamples = 0;
+        lastBadTime = 0;
+        lastRaw = 0;
+        stuckSince = 0;
+        resetRate();
+        faultCount = 0;
+    }
+
+    // Forget the previous sample for the rate check, e.g. after the calibration changed
+    // and the next temperature is not comparable with it
+    void resetRate() {
+        hasPrevious = false;
+        previousTime = 0;
+        previousTemperature = 0;
+    }
+
+    // Evaluate one sample and return the resulting health state
+    State update(uint16_t raw, float temperature, float maxRate, unsigned long now) {
+        State candidate = evaluate(raw, temperature, maxRate, now);
+
+        if (candidate == HEALTH_OK) {
+            badSamples = 0;
+            if (state == HEALTH_NO_DATA ||
+                (state != HEALTH_OK && now - lastBadTime >= SENSOR_FAULT_CLEAR_TIME)) {
+                state = HEALTH_OK;
+            }
+        } else {
+            lastBadTime = now;
+            if (++badSamples >= SENSOR_FAULT_SAMPLES && state != candidate) {
+                state = candidate;
+                faultCount++;
+            }
+        }
+
+        return state;
+    }
+
+    State getState() const {
+        return state;
+    }
+
+    bool isOk() const {
+        return state == HEALTH_OK;
+    }
+
+    // Number of times this channel entered a fault state since boot
+    uint32_t getFaultCount() const {
+        return faultCount;
+    }
+
+    static const char* stateName(State state) {
+        switch (state) {
+            case HEALTH_OK: return "ok";
+            case HEALTH_NO_DATA: return "no_data";
+            case HEALTH_OPEN: return "open";
+            case HEALTH_SHORT: return "short";
+            case HEALTH_RATE: return "rate";
+            case HEALTH_STUCK: return "stuck";
+            default: return "unknown";
+        }
+    }
+
+private:
+    State evaluate(uint16_t raw, float temperature, float maxRate, unsigned long now) {
+        // Rail checks on the raw code
+        if (raw >= SENSOR_OPEN_CODE) {
+            return HEALTH_OPEN;
+        }
+        if (raw <= SENSOR_SHORT_CODE || isnan(temperature)) {
+            return HEALTH_SHORT;
+        }
+
+        // Stuck detector: real ADC readings always jitter by a few codes
+        if (raw != lastRaw) {
+            lastRaw = raw;
+            stuckSince = now;
+        } else if (SENSOR_STUCK_TIME > 0 && now - stuckSince >= SENSOR_STUCK_TIME) {
+            return HEALTH_STUCK;
+        }
+
+        // Rate of change from the previous sample, so each sample is judged on its own
+        // and a single jump is filtered by SENSOR_FAULT_SAMPLES like the other checks
+        bool rateFault = false;
+        if (hasPrevious && now != previousTime) {
+            float rate = fabs(temperature - previousTemperature) * 1000.0 / (now - previousTime);
+            rateFault = rate > maxRate;
+        }
+        hasPrevious = true;
+        previousTime = now;
+        previousTemperature = temperature;
+
+        return rateFault ? HEALTH_RATE : HEALTH_OK;
+    }
+
+    State state;
+    int badSamples;
+    unsigned long lastBadTime;
+    uint16_t lastRaw;
+    unsigned long stuckSince;
+    bool hasPrevious;               // previousTime/previousTemperature hold a sample
+    unsigned long previousTime;
+    float previousTemperature;
+    uint32_t faultCount;
+};
+
+#endif // SENSOR_HEALTH_H
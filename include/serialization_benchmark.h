@@ -0,0 +1,209 @@
+#ifndef SERIALIZATION_BENCHMARK_H
+#define SERIALIZATION_BENCHMARK_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "json_writer.h"
+#include "home_assistant.h"
+#include "system_state.h"
+
+// Cost of serializing the Home Assistant state message, streamed by the real
+// HomeAssistant::writeStateMessage() versus the previous ArduinoJson path
+// (StaticJsonDocument, serializeJson into a char buffer, topic built with String).
+// Both serialize the same SystemState into memory, so only serialization is measured,
+// never the network. GET /api/json_benchmark runs it in a low priority task (start()) and
+// serves the last report, so the web server never serializes SERIALIZATION_BENCH_RUNS
+// messages itself.
+class SerializationBenchmark {
+public:
+    enum Method {
+        METHOD_ARDUINOJSON = 0,
+        METHOD_STREAMING,
+        METHOD_COUNT
+    };
+
+    struct Result {
+        uint32_t cycles;         // CPU cycles per message (average over SERIALIZATION_BENCH_RUNS)
+        uint32_t bytes;          // Payload length
+        uint32_t workingMemory;  // Stack used for documents and buffers (bytes)
+        uint32_t heapUsed;       // Free heap lost while the message was being built (bytes)
+    };
+
+    // Last finished run of every method
+    struct Report {
+        bool running;            // A run is in progress
+        uint32_t completed;      // Runs finished since boot, 0 = no results yet
+        Result results[METHOD_COUNT];
+    };
+
+    // Start a run in the background unless one is in progress. Higher priority tasks
+    // that preempt it are counted in its cycles, so compare runs made under similar load
+    static void start() {
+        Shared& data = shared();
+        portENTER_CRITICAL(&data.lock);
+        bool idle = !data.report.running;
+        data.report.running = true;
+        portEXIT_CRITICAL(&data.lock);
+
+        if (idle && xTaskCreate(taskEntry, "json_bench", SERIALIZATION_TASK_STACK, nullptr,
+                                SERIALIZATION_TASK_PRIORITY, nullptr) != pdPASS) {
+            portENTER_CRITICAL(&data.lock);
+            data.report.running = false;
+            portEXIT_CRITICAL(&data.lock);
+        }
+    }
+
+    static Report getReport() {
+        Shared& data = shared();
+        portENTER_CRITICAL(&data.lock);
+        Report report = data.report;
+        portEXIT_CRITICAL(&data.lock);
+        return report;
+    }
+
+    static const char* methodName(int method) {
+        switch (method) {
+            case METHOD_ARDUINOJSON: return "arduinojson";
+            case METHOD_STREAMING: return "streaming";
+            default: return "unknown";
+        }
+    }
+
+    static Result run(int method) {
+        Result result = {0, 0, 0, 0};
+        SystemState state = sampleState();
+        PrintCounter out;
+
+        uint32_t start = ESP.getCycleCount();
+        for (int i = 0; i < SERIALIZATION_BENCH_RUNS; i++) {
+            out.count = 0;
+            if (method == METHOD_ARDUINOJSON) {
+                writeDocument(out, state, result);
+            } else {
+                writeStreaming(out, state, result);
+            }
+        }
+        result.cycles = (ESP.getCycleCount() - start) / SERIALIZATION_BENCH_RUNS;
+        result.bytes = out.count;
+        return result;
+    }
+
+private:
+    static const int MESSAGE_SIZE = 768;
+
+    struct Shared {
+        Report report = {false, 0, {}};
+        portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    };
+
+    static Shared& shared() {
+        static Shared data;
+        return data;
+    }
+
+    static void taskEntry(void* param) {
+        Result results[METHOD_COUNT];
+        for (int i = 0; i < METHOD_COUNT; i++) {
+            results[i] = run(i);
+        }
+
+        Shared& data = shared();
+        portENTER_CRITICAL(&data.lock);
+        memcpy(data.report.results, results, sizeof(results));
+        data.report.completed++;
+        data.report.running = false;
+        portEXIT_CRITICAL(&data.lock);
+        vTaskDelete(nullptr);
+    }
+
+    // Representative state: a burning boiler with every sensor healthy
+    static SystemState sampleState() {
+        SystemState state;
+        const float temperatures[SENSOR_CHANNEL_COUNT] = {71.25f, 58.5f, 142.75f, 19.5f};
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            state.sensors.temperature[i] = temperatures[i];
+            state.sensors.valid[i] = true;
+            state.sensors.health[i] = SensorHealth::HEALTH_OK;
+        }
+        state.boilerPump = true;
+        state.heatingPump = true;
+        state.targetBurningTemp = 85.0f;
+        state.airIntake = 42;
+        state.kp = 2.75f;
+        state.ki = 0.0125f;
+        state.kd = 0.0f;
+        state.autoTune.state = PIDAutoTune::STATE_DONE;
+        return state;
+    }
+
+    static void recordHeap(Result& result, uint32_t heapBefore) {
+        uint32_t heapNow = ESP.getFreeHeap();
+        if (heapNow < heapBefore) {
+            result.heapUsed = max(result.heapUsed, heapBefore - heapNow);
+        }
+    }
+
+    static const char* onOff(bool value) {
+        return value ? "ON" : "OFF";
+    }
+
+    // The same members as HomeAssistant::writeStateMessage(), the way they were built
+    // before streaming
+    static void writeDocument(Print& out, const SystemState& state, Result& result) {
+        uint32_t heapBefore = ESP.getFreeHeap();
+        const SensorSnapshot& sensors = state.sensors;
+
+        StaticJsonDocument<MESSAGE_SIZE> doc;
+        doc["boiler_water_temp"] = sensors.boilerWater();
+        doc["heating_temp"] = sensors.heating();
+        doc["burning_temp"] = sensors.burning();
+        doc["ambient_temp"] = sensors.ambient();
+        doc["boiler_pump"] = onOff(state.boilerPump);
+        doc["heating_pump"] = onOff(state.heatingPump);
+        doc["fans"] = onOff(state.fans);
+        doc["other_relay"] = onOff(state.otherRelay);
+        doc["killswitch"] = onOff(state.killSwitch);
+        bool sensorFault = false;
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            sensorFault = sensorFault || sensors.isFaulted(i);
+        }
+        doc["sensor_fault"] = onOff(sensorFault);
+        doc["target_burning_temp"] = state.targetBurningTemp;
+        doc["air_intake"] = state.airIntake;
+        doc["servo_min"] = state.servoMin;
+        doc["servo_max"] = state.servoMax;
+        doc["autotune"] = PIDAutoTune::stateName(state.autoTune.state);
+        doc["pid_kp"] = state.kp;
+        doc["pid_ki"] = state.ki;
+        doc["pid_kd"] = state.kd;
+        JsonObject health = doc.createNestedObject("sensor_health");
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            health[sensorChannelName(i)] = SensorHealth::stateName(sensors.health[i]);
+        }
+
+        char buffer[MESSAGE_SIZE];
+        size_t length = serializeJson(doc, buffer);
+        String topic = String(MQTT_BASE_TOPIC) + "/state";
+
+        recordHeap(result, heapBefore);
+        result.workingMemory = sizeof(doc) + sizeof(buffer);
+        out.write((const uint8_t*)buffer, length);
+    }
+
+    // The real publishing code, into a buffer instead of the MQTT client. The buffer only
+    // captures the output; update() streams it and keeps none
+    static void writeStreaming(Print& out, const SystemState& state, Result& result) {
+        char buffer[MESSAGE_SIZE];
+        uint32_t heapBefore = ESP.getFreeHeap();
+
+        BufferPrint message(buffer, sizeof(buffer));
+        HomeAssistant::writeStateMessage(message, state);
+
+        recordHeap(result, heapBefore);
+        result.workingMemory = sizeof(JsonWriter);
+        out.write((const uint8_t*)message.c_str(), message.isOverflow() ? 0 : message.getLength());
+    }
+};
+
+#endif // SERIALIZATION_BENCHMARK_H
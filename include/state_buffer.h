@@ -0,0 +1,50 @@
+#ifndef STATE_BUFFER_H
+#define STATE_BUFFER_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Single writer, many readers value exchange (seqlock over two buffers).
+// The writer fills the buffer readers are not using and then publishes it, so it never
+// waits. A reader copies the published buffer and only retries if the writer came back
+// to that same buffer during the copy (two publishes in the middle of one copy), so
+// readers never block the writer nor see a torn value. T must be trivially copyable
+template <typename T>
+class StateBuffer {
+public:
+    StateBuffer() : sequence(0) {}
+
+    // Writer side (one task only)
+    void publish(const T& value) {
+        uint32_t current = sequence.load(std::memory_order_relaxed);
+        sequence.store(current + 1, std::memory_order_relaxed);   // Odd: writing
+        std::atomic_thread_fence(std::memory_order_release);
+        buffers[((current >> 1) + 1) & 1] = value;
+        sequence.store(current + 2, std::memory_order_release);   // Even: published
+    }
+
+    // Copy of the last published value. Returns its publish count (0 = nothing published yet)
+    uint32_t read(T& value) const {
+        for (;;) {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            value = buffers[(before >> 1) & 1];
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint32_t after = sequence.load(std::memory_order_relaxed);
+
+            // The writer starts on the buffer just copied at sequence (before & ~1) + 3
+            if (after - (before & ~1u) < 3) {
+                return before >> 1;
+            }
+        }
+    }
+
+    uint32_t getSequence() const {
+        return sequence.load(std::memory_order_acquire) >> 1;
+    }
+
+private:
+    T buffers[2];
+    std::atomic<uint32_t> sequence;  // 2 x publishes, +1 while a publish is in progress
+};
+
+#endif // STATE_BUFFER_H
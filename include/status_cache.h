@@ -0,0 +1,117 @@
+#ifndef STATUS_CACHE_H
+#define STATUS_CACHE_H
+
+#include "arduino_compat.h"
+#include <atomic>
+#include "config.h"
+
+// Last serialized /api/status JSON.
+// Built once per control cycle by loop() and copied into every HTTP response, so requests
+// neither serialize nor read live objects. Same two buffer scheme as StateBuffer: one
+// writer, and a reader only has to retry if the writer reached its buffer during the copy.
+// The sequence only ever goes up, also when a JSON is dropped; which buffer holds the
+// published JSON is kept apart in published
+class StatusCache {
+public:
+    StatusCache() : sequence(0), published(NONE), overflows(0) {
+        lengths[0] = 0;
+        lengths[1] = 0;
+    }
+
+    // Writer side: serialize into the returned Print, then call commit()
+    Print& begin() {
+        uint32_t current = sequence.load(std::memory_order_relaxed);
+        sequence.store(current + 1, std::memory_order_relaxed);   // Odd: writing
+        std::atomic_thread_fence(std::memory_order_release);
+        writer.reset(buffers[published.load(std::memory_order_relaxed) == 0 ? 1 : 0]);
+        return writer;
+    }
+
+    // Publish what was written. If it did not fit in STATUS_JSON_SIZE the previous JSON is
+    // kept and false is returned
+    bool commit() {
+        uint32_t writing = sequence.load(std::memory_order_relaxed);
+        bool fits = !writer.overflow;
+        if (fits) {
+            int index = writer.buffer == buffers[0] ? 0 : 1;
+            writer.buffer[writer.length] = '\0';
+            lengths[index] = writer.length;
+            published.store(index, std::memory_order_release);
+        } else {
+            overflows++;
+        }
+        sequence.store(writing + 1, std::memory_order_release);   // Even: done
+        return fits;
+    }
+
+    bool isEmpty() const {
+        return published.load(std::memory_order_acquire) == NONE;
+    }
+
+    // Reader side, in place: calls reader(json, length) with the published JSON, NUL
+    // terminated. Returns false if the writer overwrote the JSON meanwhile; what the
+    // reader got is incomplete then and has to be discarded
+    template <typename TReader>
+    bool read(TReader reader) const {
+        uint32_t before = sequence.load(std::memory_order_acquire);
+        uint8_t index = published.load(std::memory_order_acquire);
+        if (index == NONE) {
+            reader("", 0);
+        } else {
+            reader((const char*)buffers[index], lengths[index]);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t after = sequence.load(std::memory_order_relaxed);
+        return after - (before & ~1u) < 3;
+    }
+
+    bool copyTo(Print& out) const {
+        return read([&](const char* json, size_t length) {
+            out.write((const uint8_t*)json, length);
+        });
+    }
+
+    // Times a JSON was dropped for not fitting in STATUS_JSON_SIZE
+    uint32_t getOverflows() const {
+        return overflows;
+    }
+
+private:
+    static const uint8_t NONE = 2;   // published before the first JSON
+
+    class Writer : public Print {
+    public:
+        char* buffer = nullptr;
+        size_t length = 0;
+        bool overflow = false;
+
+        void reset(char* target) {
+            buffer = target;
+            length = 0;
+            overflow = false;
+        }
+
+        size_t write(uint8_t c) override {
+            return write(&c, 1);
+        }
+
+        size_t write(const uint8_t* data, size_t size) override {
+            if (length + size > STATUS_JSON_SIZE) {
+                overflow = true;
+                return 0;
+            }
+            memcpy(buffer + length, data, size);
+            length += size;
+            return size;
+        }
+    };
+
+    char buffers[2][STATUS_JSON_SIZE + 1];  // + NUL
+    size_t lengths[2];
+    std::atomic<uint32_t> sequence;  // 2 x commits, +1 while writing
+    std::atomic<uint8_t> published;  // Buffer of the last JSON that fit
+    Writer writer;
+    uint32_t overflows;
+};
+
+#endif // STATUS_CACHE_H
@@ -0,0 +1,48 @@
+#ifndef SYSTEM_STATE_H
+#define SYSTEM_STATE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "temperature_sensors.h"
+#include "pid_autotune.h"
+#include "safety_supervisor.h"
+#include "loop_timing.h"
+#include "command_queue.h"
+#include "state_buffer.h"
+
+// Everything the control task decides in one cycle, as seen by the web API, MQTT and display
+struct SystemState {
+    SensorSnapshot sensors;
+    bool boilerPump = false;
+    bool heatingPump = false;
+    bool fans = false;
+    bool otherRelay = false;
+    bool killSwitch = false;
+    float targetBurningTemp = DEFAULT_TARGET_BURNING_TEMP;
+    int airIntake = 0;                         // %
+    int servoMin = DEFAULT_SERVO_MIN;          // Servo angle at 0% air
+    int servoMax = DEFAULT_SERVO_MAX;          // Servo angle at 100% air
+    float kp = PID_KP, ki = PID_KI, kd = PID_KD;  // Gains in use
+    bool autoTuning = false;
+    PIDAutoTune::Status autoTune = {PIDAutoTune::STATE_IDLE, 0, 0, 0, 0, 0, 0};
+    bool safetyActive = false;
+    SafetySupervisor::Reason safetyReason = SafetySupervisor::REASON_NONE;
+    float safetyWaterTemp = NAN;               // Last direct reading of the supervisor
+    unsigned long timestamp = 0;               // Scheduled time of the control cycle (ms)
+
+    // Counters and settings only shown by /api/status, taken with the rest of the cycle
+    // so the web server never reads the control objects themselves
+    struct SensorChannel {
+        AdcFilter::Settings filter = {0, 0};
+        unsigned long samplePeriod = 0;        // ms
+        float gain = 1, offset = 0;            // Two-point calibration
+        uint32_t faults = 0;                   // Faults raised since boot
+    };
+    SensorChannel channels[SENSOR_CHANNEL_COUNT];
+    const char* adcCalibration = "";           // ADC calibration source
+    LoopTiming::Stats controlTiming = {0, 0, 0, 0, 0, 0};  // Up to the previous cycle
+    SafetySupervisor::Stats safety = {0, 0, 0, 0, 0};
+    CommandQueue::Stats commands = {0, 0, 0, 0, 0, 0};
+};
+
+#endif // SYSTEM_STATE_H
@@ -0,0 +1,154 @@
+#ifndef TELEMETRY_QUEUE_H
+#define TELEMETRY_QUEUE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <CircularBuffer.hpp>
+#include "config.h"
+#include "temperature_sensors.h"
+
+// Compact state record kept while the broker cannot be reached
+struct TelemetryRecord {
+    uint32_t timestamp;                          // millis() when sampled
+    int16_t temperature[SENSOR_CHANNEL_COUNT];   // Tenths of degree, TEMPERATURE_NONE = no reading
+    int16_t target;                              // Tenths of degree
+    uint8_t airIntake;                           // %
+    uint8_t switches;                            // One bit per on/off field
+    uint16_t health;                             // 4 bits per sensor channel
+
+    static const int16_t TEMPERATURE_NONE = INT16_MIN;
+};
+
+// Bounded store-and-forward queue for telemetry.
+// Records go into a RAM ring; when it fills up and TELEMETRY_SPILL_TO_FS is enabled, the
+// oldest half is appended to a file on LittleFS (up to TELEMETRY_SPILL_MAX_RECORDS).
+// Records are handed back oldest first: file, then RAM. When there is no room left the
+// drop policy applies to the RAM ring (TELEMETRY_DROP_OLDEST).
+class TelemetryQueue {
+public:
+    struct Stats {
+        uint32_t queued;     // Records waiting (RAM + file)
+        uint32_t spilled;    // Records written to the file
+        uint32_t dropped;    // Records lost to the capacity limit
+        uint32_t replayed;   // Records removed with pop() once they were sent
+    };
+
+    TelemetryQueue() : fileRecords(0), fileReadIndex(0) {
+        stats = {0, 0, 0, 0};
+    }
+
+    // Call once LittleFS is mounted. Timestamps do not survive a reboot, so a spill
+    // file left by a previous run is discarded
+    void begin() {
+#if TELEMETRY_SPILL_TO_FS
+        if (LittleFS.exists(TELEMETRY_SPILL_FILE)) {
+            LittleFS.remove(TELEMETRY_SPILL_FILE);
+        }
+#endif
+    }
+
+    void push(const TelemetryRecord& record) {
+        if (ring.isFull()) {
+            makeRoom();
+        }
+
+        if (!ring.isFull()) {
+            ring.push(record);
+        } else if (TELEMETRY_DROP_OLDEST) {
+            ring.push(record);  // CircularBuffer overwrites the oldest entry
+            stats.dropped++;
+        } else {
+            stats.dropped++;
+        }
+    }
+
+    bool isEmpty() const {
+        return ring.isEmpty() && fileReadIndex >= fileRecords;
+    }
+
+    // Copy of the oldest record, left in the queue until pop(). Returns false if the
+    // queue is empty
+    bool peek(TelemetryRecord& record) {
+        if (fileReadIndex < fileRecords) {
+            if (readSpilled(record)) {
+                return true;
+            }
+            // A short or missing file means its records are gone, go on with the RAM ring
+            stats.dropped += fileRecords - fileReadIndex;
+            clearSpilled();
+        }
+        if (ring.isEmpty()) {
+            return false;
+        }
+        record = ring.first();
+        return true;
+    }
+
+    // Remove the oldest record, once the one returned by peek() has been sent
+    void pop() {
+        if (fileReadIndex < fileRecords) {
+            fileReadIndex++;
+            if (fileReadIndex >= fileRecords) {
+                clearSpilled();
+            }
+        } else if (!ring.isEmpty()) {
+            ring.shift();
+        } else {
+            return;
+        }
+        stats.replayed++;
+    }
+
+    Stats getStats() const {
+        Stats copy = stats;
+        copy.queued = ring.size() + (fileRecords - fileReadIndex);
+        return copy;
+    }
+
+private:
+    // Move the oldest half of the ring to the spill file if there is room for it
+    void makeRoom() {
+#if TELEMETRY_SPILL_TO_FS
+        uint32_t batch = TELEMETRY_QUEUE_SIZE / 2;
+        if (fileRecords + batch > TELEMETRY_SPILL_MAX_RECORDS) {
+            return;
+        }
+
+        File file = LittleFS.open(TELEMETRY_SPILL_FILE, "a");
+        if (!file) {
+            return;
+        }
+        for (uint32_t i = 0; i < batch; i++) {
+            TelemetryRecord record = ring.shift();
+            file.write((const uint8_t*)&record, sizeof(record));
+        }
+        file.close();
+
+        fileRecords += batch;
+        stats.spilled += batch;
+#endif
+    }
+
+    bool readSpilled(TelemetryRecord& record) {
+        File file = LittleFS.open(TELEMETRY_SPILL_FILE, "r");
+        bool ok = file && file.seek(fileReadIndex * sizeof(record)) &&
+                  file.read((uint8_t*)&record, sizeof(record)) == sizeof(record);
+        if (file) {
+            file.close();
+        }
+        return ok;
+    }
+
+    void clearSpilled() {
+        LittleFS.remove(TELEMETRY_SPILL_FILE);
+        fileRecords = 0;
+        fileReadIndex = 0;
+    }
+
+    CircularBuffer<TelemetryRecord, TELEMETRY_QUEUE_SIZE> ring;
+    uint32_t fileRecords;     // Records in the spill file
+    uint32_t fileReadIndex;   // Next record to replay from the file
+    Stats stats;
+};
+
+#endif // TELEMETRY_QUEUE_H
@@ -2,75 +2,422 @@
 #define TEMPERATURE_SENSORS_H
 
 #include <Arduino.h>
+#include <Preferences.h>
+#include <atomic>
 #include "config.h"
+#include "adc_calibration.h"
+#include "adc_filter.h"
+#include "ntc_table.h"
+#include "sensor_health.h"
+
+// Indexes of the NTC channels inside a sensor snapshot
+enum SensorChannel {
+    SENSOR_BOILER_WATER = 0,
+    SENSOR_HEATING,
+    SENSOR_BURNING,
+    SENSOR_AMBIENT,
+    SENSOR_CHANNEL_COUNT
+};
+
+// Result of one acquisition cycle. Every consumer (safety logic, PID, display,
+// MQTT, web API) reads the same snapshot so decisions and published values
+// always come from the same samples.
+struct SensorSnapshot {
+    uint16_t raw[SENSOR_CHANNEL_COUNT] = {0, 0, 0, 0};          // Last raw ADC codes
+    float code[SENSOR_CHANNEL_COUNT] = {0, 0, 0, 0};            // Filtered, linearized ADC codes
+    float temperature[SENSOR_CHANNEL_COUNT] = {0, 0, 0, 0};     // Converted temperatures (Celsius)
+    bool valid[SENSOR_CHANNEL_COUNT] = {false, false, false, false};  // Channel health is OK
+    SensorHealth::State health[SENSOR_CHANNEL_COUNT] = {
+        SensorHealth::HEALTH_NO_DATA, SensorHealth::HEALTH_NO_DATA,
+        SensorHealth::HEALTH_NO_DATA, SensorHealth::HEALTH_NO_DATA
+    };
+    unsigned long timestamp = 0;  // millis() when the cycle was acquired
+    uint32_t sequence = 0;        // Acquisition cycle counter (0 = no data yet)
+
+    float boilerWater() const { return temperature[SENSOR_BOILER_WATER]; }
+    float heating() const { return temperature[SENSOR_HEATING]; }
+    float burning() const { return temperature[SENSOR_BURNING]; }
+    float ambient() const { return temperature[SENSOR_AMBIENT]; }
+
+    bool isFaulted(int channel) const { return !valid[channel]; }
+
+    // Method to check if combustion is occurring
+    bool isBurning() const {
+        return burning() > BURNING_TEMP_THRESHOLD;
+    }
+
+    // Method to check if boiler water is hot enough
+    bool isBoilerWaterHot() const {
+        return boilerWater() > BOILER_WATER_TEMP_THRESHOLD;
+    }
+
+    // Method to check if water temperature has reached a critical level (killswitch)
+    bool isBoilerWaterCritical() const {
+        return boilerWater() > BOILER_WATER_CRITICAL_TEMP;
+    }
+};
+
+// Name used for each channel in the web API and MQTT payloads
+inline const char* sensorChannelName(int channel) {
+    static const char* const names[SENSOR_CHANNEL_COUNT] = {
+        "boiler_water",
+        "heating",
+        "burning",
+        "ambient"
+    };
+    return names[channel];
+}
+
+// Channel index for a name used in the web API, -1 if unknown
+inline int sensorChannelFromName(const char* name) {
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+        if (strcmp(name, sensorChannelName(i)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
 
 class TemperatureSensors {
 public:
-    TemperatureSensors() {
+    TemperatureSensors() : samplerTask(nullptr) {
+        lock = portMUX_INITIALIZER_UNLOCKED;
+
+        configureChannel(SENSOR_BOILER_WATER, SENSOR_BOILER_WATER_PERIOD, SENSOR_BOILER_WATER_MEDIAN, SENSOR_BOILER_WATER_ALPHA);
+        configureChannel(SENSOR_HEATING, SENSOR_HEATING_PERIOD, SENSOR_HEATING_MEDIAN, SENSOR_HEATING_ALPHA);
+        configureChannel(SENSOR_BURNING, SENSOR_BURNING_PERIOD, SENSOR_BURNING_MEDIAN, SENSOR_BURNING_ALPHA);
+        configureChannel(SENSOR_AMBIENT, SENSOR_AMBIENT_PERIOD, SENSOR_AMBIENT_MEDIAN, SENSOR_AMBIENT_ALPHA);
+
+        conversion[SENSOR_BOILER_WATER] = NTC_BOILER_WATER_CONVERSION;
+        conversion[SENSOR_HEATING] = NTC_HEATING_CONVERSION;
+        conversion[SENSOR_BURNING] = NTC_BURNING_CONVERSION;
+        conversion[SENSOR_AMBIENT] = NTC_AMBIENT_CONVERSION;
+
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            gain[i] = 1.0;
+            offset[i] = 0.0;
+            calibrationUnsaved[i].store(false, std::memory_order_relaxed);
+        }
     }
 
     void begin() {
         // Configure pins for NTC thermistors
-        pinMode(NTC_BOILER_WATER_PIN, INPUT);
-        pinMode(NTC_HEATING_PIN, INPUT);
-        pinMode(NTC_BURNING_PIN, INPUT);
-        pinMode(NTC_AMBIENT_PIN, INPUT);
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            pinMode(pinFor(i), INPUT);
+        }
+
+        // Build the ADC correction table and load the per-channel two-point calibration
+        calibration.begin();
+        loadCalibration();
 
         // Wait a moment for sensors to stabilize
         delay(500);
+
+        // Prime the filters so the first snapshot already has data
+        sampleAll();
+
+        // Oversample in the background so loop() only copies filtered values
+        xTaskCreate(samplerTaskEntry, "ntc_sampler", 2048, this, 2, &samplerTask);
     }
 
-    float getBoilerWaterTemperature() {
-        return readNTC(NTC_BOILER_WATER_PIN);
+    // Take one filtered reading of every channel and publish a new snapshot
+    const SensorSnapshot& acquire() {
+        SensorSnapshot next;
+
+        portENTER_CRITICAL(&lock);
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            next.raw[i] = latest[i].raw;
+            next.code[i] = latest[i].code;
+            next.temperature[i] = latest[i].temperature;
+            next.health[i] = latest[i].health;
+            next.valid[i] = latest[i].health == SensorHealth::HEALTH_OK;
+        }
+        portEXIT_CRITICAL(&lock);
+
+        next.timestamp = millis();
+        next.sequence = snapshot.sequence + 1;
+        snapshot = next;
+
+        return snapshot;
     }
 
-    float getHeatingTemperature() {
-        return readNTC(NTC_HEATING_PIN);
+    // Last published snapshot (does not touch the ADC)
+    const SensorSnapshot& getSnapshot() const {
+        return snapshot;
     }
 
-    float getBurningTemperature() {
-        return readNTC(NTC_BURNING_PIN);
+    float getBoilerWaterTemperature() const {
+        return snapshot.boilerWater();
     }
 
-    float getAmbientTemperature() {
-        return readNTC(NTC_AMBIENT_PIN);
+    float getHeatingTemperature() const {
+        return snapshot.heating();
     }
 
-    // Method to check if combustion is occurring
-    bool isBurning() {
-        return getBurningTemperature() > BURNING_TEMP_THRESHOLD;
+    float getBurningTemperature() const {
+        return snapshot.burning();
     }
 
-    // Method to check if boiler water is hot enough
-    bool isBoilerWaterHot() {
-        return getBoilerWaterTemperature() > BOILER_WATER_TEMP_THRESHOLD;
+    float getAmbientTemperature() const {
+        return snapshot.ambient();
     }
 
-    // Method to check if water temperature has reached a critical level (killswitch)
-    bool isBoilerWaterCritical() {
-        return getBoilerWaterTemperature() > BOILER_WATER_CRITICAL_TEMP;
+    bool isBurning() const {
+        return snapshot.isBurning();
+    }
+
+    bool isBoilerWaterHot() const {
+        return snapshot.isBoilerWaterHot();
+    }
+
+    bool isBoilerWaterCritical() const {
+        return snapshot.isBoilerWaterCritical();
+    }
+
+    // Change the sample period and filter of one channel (takes effect on the next sample)
+    void configureChannel(int channel, int samplePeriod, int medianWindow, float iirAlpha) {
+        if (medianWindow < 1) medianWindow = 1;
+        if (medianWindow > SENSOR_MEDIAN_MAX) medianWindow = SENSOR_MEDIAN_MAX;
+        iirAlpha = constrain(iirAlpha, 0.01f, 1.0f);
+        samplePeriod = max(samplePeriod, SENSOR_SAMPLE_INTERVAL);
+
+        portENTER_CRITICAL(&lock);
+        filterSettings[channel].medianWindow = medianWindow;
+        filterSettings[channel].iirAlpha = iirAlpha;
+        samplePeriods[channel] = samplePeriod;
+        portEXIT_CRITICAL(&lock);
+    }
+
+    AdcFilter::Settings getFilterSettings(int channel) const {
+        return filterSettings[channel];
+    }
+
+    unsigned long getSamplePeriod(int channel) const {
+        return samplePeriods[channel];
+    }
+
+    // Select formula or lookup table conversion for a channel
+    void setConversion(int channel, int method) {
+        conversion[channel] = method;
+    }
+
+    int getConversion(int channel) const {
+        return conversion[channel];
+    }
+
+    // Two-point calibration: temperatures shown by the controller (measured) against a
+    // reference thermometer at a low and a high point. Applied at once, persisted to flash
+    // by the next saveCalibrationChanges()
+    bool setTwoPointCalibration(int channel, float measuredLow, float referenceLow,
+                                float measuredHigh, float referenceHigh) {
+        if (channel < 0 || channel >= SENSOR_CHANNEL_COUNT || fabs(measuredHigh - measuredLow) < 1.0) {
+            return false;
+        }
+
+        // Undo the current correction so the new one is relative to the uncalibrated reading
+        float uncorrectedLow = (measuredLow - offset[channel]) / gain[channel];
+        float uncorrectedHigh = (measuredHigh - offset[channel]) / gain[channel];
+
+        float newGain = (referenceHigh - referenceLow) / (uncorrectedHigh - uncorrectedLow);
+        if (newGain < 0.5 || newGain > 2.0) {
+            return false;  // Implausible slope, most likely swapped or mistyped points
+        }
+
+        gain[channel] = newGain;
+        offset[channel] = referenceLow - newGain * uncorrectedLow;
+        calibrationChanged[channel] = true;
+        calibrationUnsaved[channel].store(true, std::memory_order_release);
+        return true;
+    }
+
+    void resetCalibration(int channel) {
+        gain[channel] = 1.0;
+        offset[channel] = 0.0;
+        calibrationChanged[channel] = true;
+        calibrationUnsaved[channel].store(true, std::memory_order_release);
+    }
+
+    // Write the calibrations changed since the last call to flash. A flash write can
+    // stall for tens of ms, so this runs in loop() and never in the control task, which
+    // only marks the channel. The flag is cleared before copying the coefficients, so a
+    // change made during the write is saved again on the next call
+    void saveCalibrationChanges() {
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            if (calibrationUnsaved[i].exchange(false, std::memory_order_acquire)) {
+                saveCalibration(i, gain[i], offset[i]);
+            }
+        }
+    }
+
+    float getCalibrationGain(int channel) const {
+        return gain[channel];
+    }
+
+    float getCalibrationOffset(int channel) const {
+        return offset[channel];
+    }
+
+    const char* getAdcCalibrationSource() const {
+        return calibration.getSourceName();
+    }
+
+    // Number of faults raised on a channel since boot
+    uint32_t getFaultCount(int channel) const {
+        return health[channel].getFaultCount();
+    }
+
+    // Noise of the raw samples of a channel (standard deviation in ADC codes)
+    float getRawNoise(int channel) {
+        portENTER_CRITICAL(&lock);
+        float noise = filters[channel].getRawStdDev();
+        portEXIT_CRITICAL(&lock);
+        return noise;
+    }
+
+    // Noise left after filtering (standard deviation in ADC codes)
+    float getFilteredNoise(int channel) {
+        portENTER_CRITICAL(&lock);
+        float noise = filters[channel].getFilteredStdDev();
+        portEXIT_CRITICAL(&lock);
+        return noise;
+    }
+
+    // Immediate reading of one channel, bypassing the filters and the sampler task.
+    // Calibrated and converted like the filtered readings; raw receives the ADC code
+    float readDirect(int channel, uint16_t& raw) const {
+        raw = readRaw(channel);
+        return convertToCelsius(channel, calibration.correct(raw)) * gain[channel] + offset[channel];
     }
 
 private:
-    // Method to convert analog reading to temperature in Celsius degrees
-    float readNTC(int pin) {
-        int rawADC = analogRead(pin);
+    static void samplerTaskEntry(void* param) {
+        TemperatureSensors* self = static_cast<TemperatureSensors*>(param);
+        TickType_t lastWake = xTaskGetTickCount();
+
+        for (;;) {
+            self->sampleDue();
+            vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SENSOR_SAMPLE_INTERVAL));
+        }
+    }
+
+    // Sample every channel regardless of its period (used to prime the filters)
+    void sampleAll() {
+        unsigned long now = millis();
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            sampleChannel(i, now);
+        }
+    }
+
+    // Sample only the channels whose period has elapsed
+    void sampleDue() {
+        unsigned long now = millis();
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            if (now - lastSampleTime[i] >= samplePeriods[i]) {
+                sampleChannel(i, now);
+            }
+        }
+    }
+
+    // Oversampled ADC code of one channel
+    static uint16_t readRaw(int channel) {
+        uint32_t sum = 0;
+        for (int n = 0; n < SENSOR_OVERSAMPLING; n++) {
+            sum += analogRead(pinFor(channel));
+        }
+        return (sum + SENSOR_OVERSAMPLING / 2) / SENSOR_OVERSAMPLING;
+    }
+
+    // Oversample, filter, convert and check one channel
+    void sampleChannel(int i, unsigned long now) {
+        lastSampleTime[i] = now;
+        uint16_t raw = readRaw(i);
 
-        // Constants for 10k NTC thermistor
-        float c1 = 1.009249522e-03, c2 = 2.378405444e-04, c3 = 2.019202697e-07;
+        portENTER_CRITICAL(&lock);
+        float filtered = filters[i].push(raw, filterSettings[i]);
+        portEXIT_CRITICAL(&lock);
 
-        // Thermistor resistance
-        float resistor = NTC_SERIES_RESISTOR / ((4095.0 / rawADC) - 1.0);
+        // A calibration step is not a temperature change
+        if (calibrationChanged[i]) {
+            calibrationChanged[i] = false;
+            health[i].resetRate();
+        }
 
-        // Steinhart-Hart formula to convert resistance to temperature
-        float logR = log(resistor);
-        float temp = 1.0 / (c1 + c2 * logR + c3 * logR * logR * logR);
+        float code = calibration.correct(filtered);
+        float temperature = convertToCelsius(i, code) * gain[i] + offset[i];
+        SensorHealth::State state = health[i].update(raw, temperature, SENSOR_MAX_RATE, now);
 
-        // Convert from Kelvin to Celsius
-        temp = temp - 273.15;
+        portENTER_CRITICAL(&lock);
+        latest[i].raw = raw;
+        latest[i].code = code;
+        latest[i].temperature = temperature;
+        latest[i].health = state;
+        portEXIT_CRITICAL(&lock);
+    }
+
+    void loadCalibration() {
+        Preferences prefs;
+        prefs.begin("ntc_cal", true);
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            gain[i] = prefs.getFloat(calibrationKey("g", i).c_str(), 1.0);
+            offset[i] = prefs.getFloat(calibrationKey("o", i).c_str(), 0.0);
+        }
+        prefs.end();
+    }
 
-        return temp;
+    static void saveCalibration(int channel, float channelGain, float channelOffset) {
+        Preferences prefs;
+        prefs.begin("ntc_cal", false);
+        prefs.putFloat(calibrationKey("g", channel).c_str(), channelGain);
+        prefs.putFloat(calibrationKey("o", channel).c_str(), channelOffset);
+        prefs.end();
     }
+
+    static String calibrationKey(const char* prefix, int channel) {
+        return String(prefix) + String(channel);
+    }
+
+    // Method to convert an ADC reading to temperature in Celsius degrees
+    float convertToCelsius(int channel, float rawADC) const {
+        if (conversion[channel] == NTC_CONVERSION_TABLE) {
+            return NtcTable::lookup(rawADC);
+        }
+        return NtcTable::steinhartHart(rawADC);
+    }
+
+    // ADC pin of each channel, in SensorChannel order
+    static uint8_t pinFor(int channel) {
+        static const uint8_t pins[SENSOR_CHANNEL_COUNT] = {
+            NTC_BOILER_WATER_PIN,
+            NTC_HEATING_PIN,
+            NTC_BURNING_PIN,
+            NTC_AMBIENT_PIN
+        };
+        return pins[channel];
+    }
+
+    // Latest sample of a channel, written by the sampler task
+    struct ChannelSample {
+        uint16_t raw = 0;
+        float code = 0;
+        float temperature = NAN;
+        SensorHealth::State health = SensorHealth::HEALTH_NO_DATA;
+    };
+
+    SensorSnapshot snapshot;
+    ChannelSample latest[SENSOR_CHANNEL_COUNT];
+    SensorHealth health[SENSOR_CHANNEL_COUNT];
+    AdcFilter filters[SENSOR_CHANNEL_COUNT];
+    AdcFilter::Settings filterSettings[SENSOR_CHANNEL_COUNT];
+    unsigned long samplePeriods[SENSOR_CHANNEL_COUNT];
+    unsigned long lastSampleTime[SENSOR_CHANNEL_COUNT] = {0, 0, 0, 0};
+    portMUX_TYPE lock;
+    TaskHandle_t samplerTask;
+    int conversion[SENSOR_CHANNEL_COUNT];
+    AdcCalibration calibration;
+    float gain[SENSOR_CHANNEL_COUNT];    // Two-point calibration slope
+    float offset[SENSOR_CHANNEL_COUNT];  // Two-point calibration offset (Celsius)
+    volatile bool calibrationChanged[SENSOR_CHANNEL_COUNT] = {false, false, false, false};  // Reset the rate check
+    std::atomic<bool> calibrationUnsaved[SENSOR_CHANNEL_COUNT];  // Not yet written to flash
 };
 
 #endif // TEMPERATURE_SENSORS_H
@@ -11,9 +11,19 @@
 #include "air_intake.h"
 #include "display.h"
 #include "log_buffer.h"
+#include "log_drain.h"
+#include "log_store.h"
 #include "network_manager.h"
 #include "home_assistant.h"
 #include "fs_helper.h"
+#include "loop_timing.h"
+#include "safety_supervisor.h"
+#include "json_writer.h"
+#include "serialization_benchmark.h"
+#include "system_state.h"
+#include "status_cache.h"
+#include "command_queue.h"
+#include "live_events.h"
 
 // Creación del servidor web directamente en main.cpp
 AsyncWebServer webServer(WEB_SERVER_PORT);
@@ -28,8 +38,13 @@ Relay fansRelay(RELAY_FANS, "Fans");
 Relay otherRelay(RELAY_OTHER, "Other");
 
 AirIntake airIntake;
+
+// Overheat protection with authority over the pumps, fans and air intake
+SafetySupervisor safetySupervisor(sensors, boilerPumpRelay, heatingPumpRelay, fansRelay, airIntake);
 Display display;
 LogBuffer logBuffer;
+LogDrain logDrain(logBuffer, Serial);   // Serial copy of the log, written in the background
+LogStore logStore(logBuffer);           // Copy of the log on LittleFS that survives resets
 NetworkManager networkManager;
 
 // Objects for MQTT and Home Assistant
@@ -39,41 +54,86 @@ HomeAssistant homeAssistant(wifiClient);
 // Variables to manage updates and timing
 unsigned long lastDisplayUpdate = 0;
 unsigned long lastMqttUpdate = 0;
-unsigned long lastSensorRead = 0;
 unsigned long lastControlUpdate = 0;
 
+// Control task: sensor snapshot, safety evaluation and PID step every SENSOR_READ_INTERVAL,
+// independent of loop() stalls (WiFi, MQTT connects, display redraws)
+TaskHandle_t controlTaskHandle = nullptr;
+LoopTiming controlTiming(SENSOR_READ_INTERVAL);
+
 // System state variables
 bool killSwitchActive = false;  // Killswitch state (emergency mode)
+bool waterSensorFault = false;  // Boiler water NTC faulted (forces emergency mode)
+bool burningSensorFault = false;  // Burning NTC faulted (PID suspended)
+
+// Sensor snapshot of the current control cycle (control task only)
+SensorSnapshot sensorSnapshot;
+
+// State published by the control task once per cycle. The display, MQTT and web API
+// only read these copies, never the objects the control task is modifying
+StateBuffer<SystemState> systemState;
+StatusCache statusCache;           // /api/status JSON of the last published state
+uint32_t statusSequence = 0;       // State the cached JSON was built from
 
-// Variables to store sensor values
-float boilerWaterTemp = 0;
-float heatingTemp = 0;
-float burningTemp = 0;
-float ambientTemp = 0;
+// Settings and MQTT writes, applied by the control task at the start of each cycle
+CommandQueue commandQueue;
+uint32_t commandHistorySequence = 0;   // History already acknowledged on MQTT
+uint32_t lastAcknowledgedCommand = 0;
+
+// State deltas and new log lines pushed to the web interface
+LiveEvents liveEvents("/api/events");
 
 // Functions to handle different system states and actions
 void readSensors() {
-    // Read temperatures from sensors
-    boilerWaterTemp = sensors.getBoilerWaterTemperature();
-    heatingTemp = sensors.getHeatingTemperature();
-    burningTemp = sensors.getBurningTemperature();
-    ambientTemp = sensors.getAmbientTemperature();
+    // Read every channel once per cycle
+    sensorSnapshot = sensors.acquire();
 }
 
-void handleCriticalTemperature() {
-    // Activate all pumps to evacuate heat
-    boilerPumpRelay.setState(true);
-    heatingPumpRelay.setState(true);
+// Log health transitions and derive the fault flags used by the control logic
+void updateSensorFaults() {
+    static SensorHealth::State lastHealth[SENSOR_CHANNEL_COUNT] = {
+        SensorHealth::HEALTH_OK, SensorHealth::HEALTH_OK,
+        SensorHealth::HEALTH_OK, SensorHealth::HEALTH_OK
+    };
 
-    // Completely close the air intake
-    airIntake.setPosition(0);
+    // Channels report no data until their first sample, only a fault if it never comes
+    bool warmingUp = millis() < SENSOR_WARMUP_TIME;
+    auto faulted = [warmingUp](int channel) {
+        return sensorSnapshot.isFaulted(channel) &&
+               !(warmingUp && sensorSnapshot.health[channel] == SensorHealth::HEALTH_NO_DATA);
+    };
 
-    // Activate fans for cooling
-    fansRelay.setState(true);
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+        SensorHealth::State state = sensorSnapshot.health[i];
+        if (warmingUp && state == SensorHealth::HEALTH_NO_DATA) {
+            continue;
+        }
+        if (state != lastHealth[i]) {
+            if (state == SensorHealth::HEALTH_OK) {
+                LOG_INFO(MSG_SENSOR_RECOVERED, sensorChannelName(i));
+            } else {
+                LOG_ERROR(MSG_SENSOR_FAULT, sensorChannelName(i), SensorHealth::stateName(state));
+            }
+            lastHealth[i] = state;
+        }
+    }
+
+    waterSensorFault = faulted(SENSOR_BOILER_WATER);
+    burningSensorFault = faulted(SENSOR_BURNING);
+}
+
+void handleCriticalTemperature() {
+    // The safety supervisor already holds the pumps and fans on and the air intake closed
 
     // Log critical event if it's the first time it's activated
     if (!killSwitchActive) {
-        logBuffer.log("ALERT! Critical water temperature: " + String(boilerWaterTemp) + "°C - Emergency mode activated");
+        SafetySupervisor::Stats safety = safetySupervisor.getStats();
+        if (safetySupervisor.getReason() == SafetySupervisor::REASON_CRITICAL_TEMP) {
+            LOG_ERROR(MSG_CRITICAL_TEMPERATURE, safetySupervisor.getTemperature());
+        } else {
+            LOG_ERROR(MSG_WATER_TEMPERATURE_UNKNOWN);
+        }
+        LOG_WARN(MSG_SAFETY_REACTION, safety.lastReaction);
         killSwitchActive = true;
     }
 }
@@ -81,7 +141,7 @@ void handleCriticalTemperature() {
 void handleNormalOperation(bool isBurning, bool isBoilerWaterHot) {
     // Restore normal operation if we were in critical mode
     if (killSwitchActive) {
-        logBuffer.log("Water temperature normalized: " + String(boilerWaterTemp) + "°C - Normal mode restored");
+        LOG_INFO(MSG_WATER_TEMPERATURE_NORMAL, sensorSnapshot.boilerWater());
         killSwitchActive = false;
     }
 
@@ -106,6 +166,247 @@ void handleNormalOperation(bool isBurning, bool isBoilerWaterHot) {
     }
 }
 
+// Log the outcome of an auto-tuning when it finishes
+void checkAutoTuneResult() {
+    static PIDAutoTune::State lastState = PIDAutoTune::STATE_IDLE;
+    PIDAutoTune::Status status = airIntake.getAutoTuneStatus();
+
+    if (status.state == lastState) {
+        return;
+    }
+    lastState = status.state;
+
+    if (status.state == PIDAutoTune::STATE_DONE) {
+        LOG_INFO(MSG_AUTOTUNE_DONE, status.cycles, status.ku, status.tu,
+                      airIntake.getKp(), airIntake.getKi(), airIntake.getKd());
+    } else if (status.state == PIDAutoTune::STATE_FAILED) {
+        LOG_WARN(MSG_AUTOTUNE_FAILED, status.cycles, status.spread * 100);
+    }
+}
+
+Command makeCommand(Command::Source source, Command::Type type, int channel = 0,
+                    float v0 = 0, float v1 = 0, float v2 = 0, float v3 = 0) {
+    Command command;
+    command.type = type;
+    command.source = source;
+    command.channel = channel;
+    command.value[0] = v0;
+    command.value[1] = v1;
+    command.value[2] = v2;
+    command.value[3] = v3;
+    return command;
+}
+
+Relay* relayById(int id) {
+    switch (id) {
+        case Command::RELAY_ID_BOILER_PUMP: return &boilerPumpRelay;
+        case Command::RELAY_ID_HEATING_PUMP: return &heatingPumpRelay;
+        case Command::RELAY_ID_FANS: return &fansRelay;
+        default: return &otherRelay;
+    }
+}
+
+// Apply one external command. Returns the rejection reason, nullptr if applied
+const char* applyCommand(const Command& command) {
+    const char* source = command.source == Command::SOURCE_MQTT ? " from MQTT" : "";
+
+    switch (command.type) {
+        case Command::TARGET_TEMPERATURE:
+            airIntake.setTargetTemperature(command.value[0]);
+            LOG_INFO(MSG_TARGET_TEMPERATURE, source, command.value[0]);
+            return nullptr;
+
+        case Command::SERVO_MIN:
+            if (command.value[0] >= airIntake.getServoMax()) {
+                return "out_of_range";
+            }
+            airIntake.setServoMin(command.value[0]);
+            LOG_INFO(MSG_SERVO_MIN, airIntake.getServoMin());
+            return nullptr;
+
+        case Command::SERVO_MAX:
+            if (command.value[0] <= airIntake.getServoMin()) {
+                return "out_of_range";
+            }
+            airIntake.setServoMax(command.value[0]);
+            LOG_INFO(MSG_SERVO_MAX, airIntake.getServoMax());
+            return nullptr;
+
+        case Command::AUTOTUNE:
+            if (airIntake.isAutoTuning()) {
+                // If there's already an auto-tuning in progress, cancel it
+                airIntake.cancelAutoTune();
+                LOG_INFO(MSG_AUTOTUNE_CANCELED);
+                return nullptr;
+            }
+            if (killSwitchActive) {
+                return "safety_active";
+            }
+            if (burningSensorFault) {
+                return "sensor_fault";
+            }
+            if (!airIntake.startAutoTune()) {
+                return "autotune_unavailable";
+            }
+            LOG_INFO(MSG_AUTOTUNE_STARTED);
+            return nullptr;
+
+        case Command::RELAY: {
+            // Pumps and fans are driven every cycle by handleNormalOperation() (or held by
+            // the safety supervisor), which would undo the command in the same cycle. Only
+            // the spare relay is under manual control
+            if (command.channel != Command::RELAY_ID_OTHER) {
+                return "automatic_control";
+            }
+            Relay* relay = relayById(command.channel);
+            bool state = command.value[0] != 0;
+            relay->setState(state);
+            LOG_INFO(MSG_RELAY_STATE, relay->getName(), source, state ? "ON" : "OFF");
+            return nullptr;
+        }
+
+        case Command::SENSOR_FILTER: {
+            int channel = command.channel;
+            AdcFilter::Settings filterSettings = sensors.getFilterSettings(channel);
+            sensors.configureChannel(channel,
+                isnan(command.value[0]) ? (int)sensors.getSamplePeriod(channel) : (int)command.value[0],
+                isnan(command.value[1]) ? (int)filterSettings.medianWindow : (int)command.value[1],
+                isnan(command.value[2]) ? filterSettings.iirAlpha : command.value[2]);
+            filterSettings = sensors.getFilterSettings(channel);
+            LOG_INFO(MSG_SENSOR_FILTER, sensorChannelName(channel), sensors.getSamplePeriod(channel),
+                          filterSettings.medianWindow, filterSettings.iirAlpha);
+            return nullptr;
+        }
+
+        case Command::CALIBRATION:
+            if (!sensors.setTwoPointCalibration(command.channel, command.value[0], command.value[1],
+                                                command.value[2], command.value[3])) {
+                return "invalid_points";
+            }
+            LOG_INFO(MSG_CALIBRATION, sensorChannelName(command.channel),
+                          sensors.getCalibrationGain(command.channel), sensors.getCalibrationOffset(command.channel));
+            return nullptr;
+
+        case Command::CALIBRATION_RESET:
+            sensors.resetCalibration(command.channel);
+            LOG_INFO(MSG_CALIBRATION_RESET, sensorChannelName(command.channel));
+            return nullptr;
+
+        default:
+            return "unknown_command";
+    }
+}
+
+// Apply the commands queued since the last cycle
+void processCommands() {
+    Command command;
+    for (int i = 0; i < CommandQueue::CAPACITY && commandQueue.next(command); i++) {
+        const char* reason = applyCommand(command);
+        if (reason) {
+            LOG_WARN(MSG_COMMAND_REJECTED, Command::typeName(command.type), reason);
+        }
+        commandQueue.complete(command, reason);
+    }
+}
+
+// Publish the outcome of the control cycle for the other tasks
+void publishSystemState(unsigned long now) {
+    SystemState state;
+    state.sensors = sensorSnapshot;
+    state.boilerPump = boilerPumpRelay.getState();
+    state.heatingPump = heatingPumpRelay.getState();
+    state.fans = fansRelay.getState();
+    state.otherRelay = otherRelay.getState();
+    state.killSwitch = killSwitchActive;
+    state.targetBurningTemp = airIntake.getTargetTemperature();
+    state.airIntake = airIntake.getCurrentOutput();
+    state.servoMin = airIntake.getServoMin();
+    state.servoMax = airIntake.getServoMax();
+    state.kp = airIntake.getKp();
+    state.ki = airIntake.getKi();
+    state.kd = airIntake.getKd();
+    state.autoTuning = airIntake.isAutoTuning();
+    state.autoTune = airIntake.getAutoTuneStatus();
+    state.safetyActive = safetySupervisor.isActive();
+    state.safetyReason = safetySupervisor.getReason();
+    state.safetyWaterTemp = safetySupervisor.getTemperature();
+    state.timestamp = now;
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+        state.channels[i].filter = sensors.getFilterSettings(i);
+        state.channels[i].samplePeriod = sensors.getSamplePeriod(i);
+        state.channels[i].gain = sensors.getCalibrationGain(i);
+        state.channels[i].offset = sensors.getCalibrationOffset(i);
+        state.channels[i].faults = sensors.getFaultCount(i);
+    }
+    state.adcCalibration = sensors.getAdcCalibrationSource();
+    state.controlTiming = controlTiming.getStats();
+    state.safety = safetySupervisor.getStats();
+    state.commands = commandQueue.getStats();
+    systemState.publish(state);
+}
+
+// One cycle of the control task. now is the scheduled time of the cycle (ms)
+void controlStep(unsigned long now) {
+    // Read all sensors
+    readSensors();
+
+    // Check sensor health before trusting any reading
+    updateSensorFaults();
+
+    // Web and MQTT requests take effect here, never in the middle of the control logic
+    processCommands();
+
+    // Faults found on the filtered readings (rate, stuck) also trip the safety supervisor
+    safetySupervisor.setExternalFault(waterSensorFault);
+
+    // Check operation conditions on the same samples that get published
+    bool isBurning = sensorSnapshot.isBurning();
+    bool isBoilerWaterHot = sensorSnapshot.isBoilerWaterHot();
+
+    // Handle different system states
+    if (safetySupervisor.isActive()) {
+        // Emergency mode - critical temperature or water temperature unknown
+        handleCriticalTemperature();
+    } else {
+        // Normal operation. Without a burning reading assume there is fire,
+        // so the boiler pump and fans keep running
+        handleNormalOperation(isBurning || burningSensorFault, isBoilerWaterHot);
+    }
+
+    // Without a burning reading the PID cannot run, hold the air intake at the safe position
+    if (burningSensorFault && !killSwitchActive) {
+        if (airIntake.isAutoTuning()) {
+            airIntake.cancelAutoTune();
+            LOG_WARN(MSG_AUTOTUNE_SENSOR_FAULT);
+        }
+        airIntake.setPosition(SENSOR_FAULT_AIR_POSITION);
+    }
+
+    // Update air intake control
+    if (now - lastControlUpdate >= PID_SAMPLE_TIME && !killSwitchActive && !burningSensorFault) {
+        lastControlUpdate = now;
+
+        // In normal mode, update PID and servo
+        airIntake.update(sensorSnapshot.burning(), now);
+        checkAutoTuneResult();
+    }
+
+    publishSystemState(now);
+}
+
+void controlTask(void* param) {
+    const TickType_t period = pdMS_TO_TICKS(SENSOR_READ_INTERVAL);
+    TickType_t lastWake = xTaskGetTickCount();
+
+    while (true) {
+        vTaskDelayUntil(&lastWake, period);
+
+        controlTiming.wake(micros());
+        controlStep(lastWake * portTICK_PERIOD_MS);
+        controlTiming.done(micros());
+    }
+}
+
 void turnOffAllRelays() {
     boilerPumpRelay.setState(false);
     heatingPumpRelay.setState(false);
@@ -113,52 +414,283 @@ void turnOffAllRelays() {
     otherRelay.setState(false);
 }
 
-void updateHomeAssistant() {
-    // Send data to Home Assistant only if there is MQTT connection
-    if (networkManager.isConnected() && homeAssistant.isMqttConnected()) {
-        homeAssistant.update(
-            boilerWaterTemp,
-            heatingTemp,
-            burningTemp,
-            ambientTemp,
-            boilerPumpRelay.getState(),
-            heatingPumpRelay.getState(),
-            fansRelay.getState(),
-            otherRelay.getState(),
-            airIntake.getTargetTemperature(),
-            airIntake.getCurrentOutput()
-        );
+void updateHomeAssistant(const SystemState& state) {
+    // Publishes when connected, queues the state for later otherwise
+    homeAssistant.update(state);
+}
+
+// Members of one command outcome (/api/settings, /api/commands)
+void writeCommandResult(JsonWriter& json, const CommandResult& result) {
+    json.add("id", result.id);
+    json.add("command", Command::typeName(result.type));
+    json.add("source", result.source == Command::SOURCE_MQTT ? "mqtt" : "web");
+    json.add("status", CommandResult::statusName(result.status));
+    if (result.reason) {
+        json.add("reason", result.reason);
     }
+    if (result.status != CommandResult::STATUS_QUEUED) {
+        json.add("latency", result.latency);
+    }
+}
+
+// Command queue counters, latency in us
+void writeCommandStats(JsonWriter& json, const CommandQueue::Stats& stats) {
+    json.add("submitted", stats.submitted);
+    json.add("applied", stats.applied);
+    json.add("rejected", stats.rejected);
+    json.add("dropped", stats.dropped);
+    json.add("last_latency", stats.lastLatency);
+    json.add("max_latency", stats.maxLatency);
+}
+
+// System state as JSON, written member by member into out (see /api/status)
+void writeStatus(Print& out, const SystemState& state) {
+    const SensorSnapshot& snapshot = state.sensors;
+    JsonWriter json(out);
+
+    json.beginObject();
+    json.add("boiler_water_temp", snapshot.boilerWater());
+    json.add("heating_temp", snapshot.heating());
+    json.add("burning_temp", snapshot.burning());
+    json.add("ambient_temp", snapshot.ambient());
+    json.add("boiler_pump", state.boilerPump);
+    json.add("heating_pump", state.heatingPump);
+    json.add("fans", state.fans);
+    json.add("other", state.otherRelay);
+    json.add("target_burning_temp", state.targetBurningTemp);
+    json.add("air_intake", state.airIntake);
+    json.add("auto_tuning", state.autoTuning);
+    json.add("killswitch_active", state.killSwitch);
+    json.add("timestamp", state.timestamp);
+
+    // Add servo range configuration
+    json.add("servo_min", state.servoMin);
+    json.add("servo_max", state.servoMax);
+
+    // Add current PID parameters
+    json.beginObject("pid");
+    json.add("kp", state.kp);
+    json.add("ki", state.ki);
+    json.add("kd", state.kd);
+    json.endObject();
+
+    // Add control loop timing (us)
+    const LoopTiming::Stats& timing = state.controlTiming;
+    json.beginObject("control_loop");
+    json.add("period", SENSOR_READ_INTERVAL * 1000);
+    json.add("min_period", timing.minPeriod);
+    json.add("max_period", timing.maxPeriod);
+    json.add("p99_jitter", timing.p99Jitter);
+    json.add("max_execution", timing.maxExecution);
+    json.add("overruns", timing.overruns);
+    json.add("cycles", timing.cycles);
+    json.endObject();
+
+    // Add safety supervisor state and reaction times (us)
+    const SafetySupervisor::Stats& safetyStats = state.safety;
+    json.beginObject("safety");
+    json.add("active", state.safetyActive);
+    json.add("reason", SafetySupervisor::reasonName(state.safetyReason));
+    json.add("water_temp", state.safetyWaterTemp);
+    json.add("trips", safetyStats.trips);
+    json.add("last_latency", safetyStats.lastLatency);
+    json.add("max_latency", safetyStats.maxLatency);
+    json.add("last_reaction", safetyStats.lastReaction);
+    json.add("max_reaction", safetyStats.maxReaction);
+    json.endObject();
+
+    // Add external command counters and latency (us)
+    json.beginObject("commands");
+    writeCommandStats(json, state.commands);
+    json.endObject();
+
+    // Add MQTT connection state and counters
+    HomeAssistant::ConnectionStats mqttStats = homeAssistant.getStats();
+    json.beginObject("mqtt");
+    json.add("state", HomeAssistant::stateName(homeAssistant.getState()));
+    json.add("attempts", mqttStats.attempts);
+    json.add("connects", mqttStats.connects);
+    json.add("failures", mqttStats.failures);
+    json.add("time_to_connect", mqttStats.timeToConnect);
+    json.add("blocked_total", mqttStats.blockedTotal);
+    json.add("blocked_max", mqttStats.blockedMax);
+    json.add("backoff", mqttStats.backoff);
+
+    HomeAssistant::CommandStats commandStats = homeAssistant.getCommandStats();
+    json.add("commands", commandStats.commands);
+    json.add("command_latency", commandStats.lastLatency);
+    json.add("command_latency_max", commandStats.maxLatency);
+    json.add("service_gap_max", commandStats.maxServiceGap);
+
+    HomeAssistant::TelemetryStats telemetryStats = homeAssistant.getTelemetryStats();
+    json.add("messages", telemetryStats.messages);
+    json.add("bytes", telemetryStats.bytes);
+
+    TelemetryQueue::Stats queueStats = homeAssistant.getQueueStats();
+    json.beginObject("queue");
+    json.add("queued", queueStats.queued);
+    json.add("spilled", queueStats.spilled);
+    json.add("dropped", queueStats.dropped);
+    json.add("replayed", queueStats.replayed);
+    json.endObject();
+    json.endObject();
+
+    // Add live event stream clients and counters
+    LiveEvents::Stats eventStats = liveEvents.getStats();
+    json.beginObject("events");
+    json.add("clients", eventStats.clients);
+    json.add("rejected", eventStats.rejected);
+    json.add("keyframes", eventStats.keyframes);
+    json.add("deltas", eventStats.deltas);
+    json.add("logs", eventStats.logs);
+    json.add("held_back", eventStats.heldBack);
+    json.endObject();
+
+    // Add log arena usage
+    LogBuffer::Stats logStats = logBuffer.getStats();
+    json.beginObject("log");
+    json.add("entries", logStats.entries);
+    json.add("bytes_used", logStats.bytesUsed);
+    json.add("bytes_total", LOG_ARENA_SIZE);
+    json.add("logged", logStats.logged);
+    json.add("dropped", logStats.dropped);
+
+    json.beginObject("levels");
+    for (int i = 0; i < LOG_SOURCE_COUNT; i++) {
+        json.add(logSourceName(i), logLevelName(logBuffer.getLevel(i)));
+    }
+    json.endObject();
+
+    LogDrain::Stats serialStats = logDrain.getStats();
+    json.add("serial_printed", serialStats.printed);
+    json.add("serial_dropped", serialStats.dropped);
+
+    LogStore::Stats storeStats = logStore.getStats();
+    json.beginObject("store");
+    json.add("enabled", storeStats.enabled);
+    json.add("segment", storeStats.segment);
+    json.add("flushes", storeStats.flushes);
+    json.add("lines", storeStats.lines);
+    json.add("bytes", storeStats.bytes);
+    json.add("lost", storeStats.lost);
+    json.add("errors", storeStats.errors);
+    json.add("last_flush", storeStats.lastFlush);
+    json.add("max_flush", storeStats.maxFlush);
+    json.endObject();
+    json.endObject();
+
+    // Add auto-tuning progress
+    const PIDAutoTune::Status& tuneStatus = state.autoTune;
+    json.beginObject("autotune");
+    json.add("state", PIDAutoTune::stateName(tuneStatus.state));
+    json.add("cycles", tuneStatus.cycles);
+    json.add("ku", tuneStatus.ku);
+    json.add("tu", tuneStatus.tu);
+    json.add("amplitude", tuneStatus.amplitude);
+    json.add("spread", tuneStatus.spread);
+    json.add("elapsed", tuneStatus.elapsed / 1000);
+    json.endObject();
+
+    // Add per-channel sampling/filter configuration and noise (ADC codes)
+    json.beginObject("sensor_filter");
+    json.add("oversampling", SENSOR_OVERSAMPLING);
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+        const SystemState::SensorChannel& channel = state.channels[i];
+        json.beginObject(sensorChannelName(i));
+        json.add("sample_period", channel.samplePeriod);
+        json.add("median_window", channel.filter.medianWindow);
+        json.add("iir_alpha", channel.filter.iirAlpha);
+        json.endObject();
+    }
+    json.endObject();
+
+    json.beginObject("sensor_noise");
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+        json.beginObject(sensorChannelName(i));
+        json.add("raw", sensors.getRawNoise(i));
+        json.add("filtered", sensors.getFilteredNoise(i));
+        json.endObject();
+    }
+    json.endObject();
+
+    // Add per-channel sensor health
+    json.beginObject("sensor_health");
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+        json.beginObject(sensorChannelName(i));
+        json.add("state", SensorHealth::stateName(snapshot.health[i]));
+        json.add("faults", state.channels[i].faults);
+        json.endObject();
+    }
+    json.endObject();
+
+    // Add ADC calibration source and per-channel two-point correction
+    json.beginObject("sensor_calibration");
+    json.add("adc", state.adcCalibration);
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+        json.beginObject(sensorChannelName(i));
+        json.add("gain", state.channels[i].gain);
+        json.add("offset", state.channels[i].offset);
+        json.endObject();
+    }
+    json.endObject();
+
+    json.endObject();
 }
 
 // Callback to receive MQTT messages
 void mqttCallback(char* topic, byte* payload, unsigned int length) {
-    String topicStr = String(topic);
-    payload[length] = '\0';
-    String message = String((char*)payload);
-
-    logBuffer.log("MQTT received: " + topicStr + " -> " + message);
-
-    if (topicStr.endsWith("/set/target_burning_temp")) {
-        float targetTemp = message.toFloat();
-        airIntake.setTargetTemperature(targetTemp);
-        logBuffer.log("New target temperature from MQTT: " + String(targetTemp) + "°C");
-    } else if (topicStr.endsWith("/set/boiler_pump")) {
-        bool state = (message == "ON");
-        boilerPumpRelay.setState(state);
-        logBuffer.log("Boiler pump state from MQTT: " + String(state ? "ON" : "OFF"));
-    } else if (topicStr.endsWith("/set/heating_pump")) {
-        bool state = (message == "ON");
-        heatingPumpRelay.setState(state);
-        logBuffer.log("Heating pump state from MQTT: " + String(state ? "ON" : "OFF"));
-    } else if (topicStr.endsWith("/set/fans")) {
-        bool state = (message == "ON");
-        fansRelay.setState(state);
-        logBuffer.log("Fans state from MQTT: " + String(state ? "ON" : "OFF"));
-    } else if (topicStr.endsWith("/set/other_relay")) {
-        bool state = (message == "ON");
-        otherRelay.setState(state);
-        logBuffer.log("Other device state from MQTT: " + String(state ? "ON" : "OFF"));
+    // The payload is not terminated, copy it to parse it
+    char message[16];
+    length = min(length, (unsigned int)sizeof(message) - 1);
+    memcpy(message, payload, length);
+    message[length] = '\0';
+
+    LOG_DEBUG(MSG_MQTT_RECEIVED, topic, message);
+
+    const char* setting = strstr(topic, "/set/");
+    setting = setting ? setting + 5 : "";
+    bool on = strcmp(message, "ON") == 0;
+
+    Command command;
+    if (strcmp(setting, "target_burning_temp") == 0) {
+        command = makeCommand(Command::SOURCE_MQTT, Command::TARGET_TEMPERATURE, 0, atof(message));
+    } else if (strcmp(setting, "boiler_pump") == 0) {
+        command = makeCommand(Command::SOURCE_MQTT, Command::RELAY, Command::RELAY_ID_BOILER_PUMP, on);
+    } else if (strcmp(setting, "heating_pump") == 0) {
+        command = makeCommand(Command::SOURCE_MQTT, Command::RELAY, Command::RELAY_ID_HEATING_PUMP, on);
+    } else if (strcmp(setting, "fans") == 0) {
+        command = makeCommand(Command::SOURCE_MQTT, Command::RELAY, Command::RELAY_ID_FANS, on);
+    } else if (strcmp(setting, "other_relay") == 0) {
+        command = makeCommand(Command::SOURCE_MQTT, Command::RELAY, Command::RELAY_ID_OTHER, on);
+    } else {
+        return;
+    }
+
+    // Applied by the control task; the outcome is published on <base>/command_result
+    CommandResult result = commandQueue.submit(command);
+    if (result.status == CommandResult::STATUS_REJECTED) {
+        LOG_WARN(MSG_MQTT_COMMAND_REJECTED, setting, result.reason);
+        homeAssistant.publishCommandResult(result);
+    }
+}
+
+// Acknowledge on MQTT the MQTT commands the control task has processed
+void acknowledgeCommands() {
+    CommandQueue::History history;
+    uint32_t sequence = commandQueue.getHistory(history);
+    if (sequence == commandHistorySequence) {
+        return;
+    }
+    commandHistorySequence = sequence;
+
+    for (int i = 0; i < history.count; i++) {
+        const CommandResult& result = history.results[i];
+        if (result.id > lastAcknowledgedCommand) {
+            lastAcknowledgedCommand = result.id;
+            if (result.source == Command::SOURCE_MQTT) {
+                homeAssistant.publishCommandResult(result);
+            }
+        }
     }
 }
 
@@ -172,6 +704,23 @@ void onWiFiDisconnected() {
     // Could update display to show disconnected status
 }
 
+// Log why the chip restarted. Watchdog, panic and brownout resets are alarms, so they
+// reach the flash log right away
+void logResetReason() {
+    switch (esp_reset_reason()) {
+        case ESP_RST_POWERON: LOG_INFO(MSG_RESET_REASON, "power on"); break;
+        case ESP_RST_EXT: LOG_INFO(MSG_RESET_REASON, "external reset"); break;
+        case ESP_RST_SW: LOG_INFO(MSG_RESET_REASON, "software restart"); break;
+        case ESP_RST_DEEPSLEEP: LOG_INFO(MSG_RESET_REASON, "deep sleep"); break;
+        case ESP_RST_PANIC: LOG_ERROR(MSG_ABNORMAL_RESET, "panic"); break;
+        case ESP_RST_INT_WDT: LOG_ERROR(MSG_ABNORMAL_RESET, "interrupt watchdog"); break;
+        case ESP_RST_TASK_WDT: LOG_ERROR(MSG_ABNORMAL_RESET, "task watchdog"); break;
+        case ESP_RST_WDT: LOG_ERROR(MSG_ABNORMAL_RESET, "watchdog"); break;
+        case ESP_RST_BROWNOUT: LOG_ERROR(MSG_ABNORMAL_RESET, "brownout"); break;
+        default: LOG_INFO(MSG_RESET_REASON, "unknown"); break;
+    }
+}
+
 void setup() {
     // Start serial communication
     Serial.begin(115200);
@@ -180,26 +729,36 @@ void setup() {
 
     // Initialize log system
     logBuffer.begin();
-    logBuffer.log("System started");
+    logDrain.begin();
+    LOG_INFO(MSG_SYSTEM_STARTED);
+    logResetReason();
 
     // Initialize temperature sensors
     sensors.begin();
-    logBuffer.log("Temperature sensors initialized");
+    LOG_INFO(MSG_SENSORS_INITIALIZED);
 
     // Initialize relays
     boilerPumpRelay.begin();
     heatingPumpRelay.begin();
     fansRelay.begin();
     otherRelay.begin();
-    logBuffer.log("Relays initialized");
+    LOG_INFO(MSG_RELAYS_INITIALIZED);
 
     // Initialize air intake servo
     airIntake.begin();
-    logBuffer.log("Air intake control initialized");
+    LOG_INFO(MSG_AIR_INTAKE_INITIALIZED);
+
+    // Start the safety supervisor before anything else can drive the outputs
+    safetySupervisor.begin();
+    LOG_INFO(MSG_SAFETY_STARTED);
+
+    // Start the control loop: from here on sensors, safety and PID run in their own task
+    xTaskCreate(controlTask, "control", CONTROL_TASK_STACK, nullptr, CONTROL_TASK_PRIORITY, &controlTaskHandle);
+    LOG_INFO(MSG_CONTROL_TASK_STARTED, SENSOR_READ_INTERVAL);
 
     // Initialize GLCD display
     display.begin();
-    logBuffer.log("Display initialized");
+    LOG_INFO(MSG_DISPLAY_INITIALIZED);
 
     // Set up WiFi connection callbacks
     networkManager.setOnWifiConnectedCallback(onWiFiConnected);
@@ -209,50 +768,118 @@ void setup() {
     homeAssistant.setCallback(mqttCallback);
 
     // Initialize WiFi connectivity and web server with references to other components
-    networkManager.begin(&logBuffer, &homeAssistant);
+    networkManager.begin(&homeAssistant);
+
+    // LittleFS is mounted now: save the log to flash, from the first line of this boot
+    logStore.begin();
+    if (!logStore.isEnabled()) {
+        LOG_WARN(MSG_LOG_STORE_UNAVAILABLE);
+    }
 
     // Configuración de rutas web estáticas desde LittleFS
     webServer.serveStatic("/", LittleFS, "/").setDefaultFile("index.html");
 
     // API: Obtener estado del sistema
     webServer.on("/api/status", HTTP_GET, [](AsyncWebServerRequest *request){
-        // Create JSON response with current system state
-        AsyncResponseStream *response = request->beginResponseStream("application/json");
+        // Served from the JSON built by loop() for the last control cycle
+        if (statusCache.isEmpty()) {
+            request->send(503, "application/json", "{\"success\":false,\"error\":\"Starting\"}");
+            return;
+        }
 
-        StaticJsonDocument<512> doc;
-        doc["boiler_water_temp"] = boilerWaterTemp;
-        doc["heating_temp"] = heatingTemp;
-        doc["burning_temp"] = burningTemp;
-        doc["ambient_temp"] = ambientTemp;
-        doc["boiler_pump"] = boilerPumpRelay.getState();
-        doc["heating_pump"] = heatingPumpRelay.getState();
-        doc["fans"] = fansRelay.getState();
-        doc["other"] = otherRelay.getState();
-        doc["target_burning_temp"] = airIntake.getTargetTemperature();
-        doc["air_intake"] = airIntake.getCurrentOutput();
-        doc["auto_tuning"] = airIntake.isAutoTuning();
-        doc["killswitch_active"] = killSwitchActive;
-
-        // Add servo range configuration
-        doc["servo_min"] = airIntake.getServoMin();
-        doc["servo_max"] = airIntake.getServoMax();
-
-        // Add current PID parameters
-        JsonObject pid = doc.createNestedObject("pid");
-        pid["kp"] = airIntake.getKp();
-        pid["ki"] = airIntake.getKi();
-        pid["kd"] = airIntake.getKd();
-
-        serializeJson(doc, *response);
+        AsyncResponseStream *response = request->beginResponseStream("application/json");
+        while (!statusCache.copyTo(*response)) {
+            // Rebuilt twice during the copy, start over with the new one
+            delete response;
+            response = request->beginResponseStream("application/json");
+        }
         request->send(response);
     });
 
-    // API: Obtener logs del sistema
+    // API: Obtener logs del sistema. ?since=<seq> returns only the messages logged after
+    // that one; X-Log-Sequence is the last message included, the `since` of the next call.
+    // Lines are copied from the log buffer into each chunk as the response is sent
     webServer.on("/api/logs", HTTP_GET, [](AsyncWebServerRequest *request){
-        request->send(200, "text/plain", logBuffer.getAll());
+        uint32_t since = 0;
+        if (request->hasParam("since")) {
+            since = strtoul(request->getParam("since")->value().c_str(), nullptr, 10);
+        }
+        LogBuffer::Cursor cursor = logBuffer.read(since);
+
+        AsyncWebServerResponse *response = request->beginChunkedResponse("text/plain",
+            [cursor](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
+                return logBuffer.copy(cursor, buffer, maxLen);
+            });
+        response->addHeader("X-Log-Sequence", String(cursor.end));
+        response->addHeader("Cache-Control", "no-store");
+        request->send(response);
     });
 
-    // API: Configurar ajustes del sistema
+    // API: Log segments saved on LittleFS, this boot and previous ones. Without parameters
+    // lists them; ?index=<n> downloads one as text
+    webServer.on("/api/log_segments", HTTP_GET, [](AsyncWebServerRequest *request){
+        if (request->hasParam("index")) {
+            char path[32];
+            LogStore::segmentPath(strtoul(request->getParam("index")->value().c_str(), nullptr, 10),
+                                  path, sizeof(path));
+            if (!LittleFS.exists(path)) {
+                request->send(404, "application/json", "{\"success\":false,\"error\":\"Unknown segment\"}");
+                return;
+            }
+            request->send(LittleFS, path, "text/plain", true);
+            return;
+        }
+
+        LogStore::Segment segments[LOG_STORE_MAX_LIST];
+        int count = logStore.listSegments(segments, LOG_STORE_MAX_LIST);
+        uint32_t current = logStore.getStats().segment;
+
+        AsyncResponseStream *response = request->beginResponseStream("application/json");
+        JsonWriter json(*response);
+        json.beginObject();
+        json.add("enabled", logStore.isEnabled());
+        json.beginArray("segments");
+        for (int i = 0; i < count; i++) {
+            json.beginObject();
+            json.add("index", segments[i].index);
+            json.add("size", segments[i].size);
+            json.add("current", segments[i].index == current);
+            json.endObject();
+        }
+        json.endArray();
+        json.endObject();
+        request->send(response);
+    });
+
+    // API: Cost of serializing the MQTT state message, streaming versus ArduinoJson.
+    // Returns the last finished run and starts a new one in the background; poll until
+    // "completed" goes up
+    webServer.on("/api/json_benchmark", HTTP_GET, [](AsyncWebServerRequest *request){
+        SerializationBenchmark::start();
+        SerializationBenchmark::Report report = SerializationBenchmark::getReport();
+
+        AsyncResponseStream *response = request->beginResponseStream("application/json");
+        JsonWriter json(*response);
+        json.beginObject();
+        json.add("runs", SERIALIZATION_BENCH_RUNS);
+        json.add("running", report.running);
+        json.add("completed", report.completed);
+        for (int i = 0; i < SerializationBenchmark::METHOD_COUNT && report.completed > 0; i++) {
+            const SerializationBenchmark::Result& result = report.results[i];
+            json.beginObject(SerializationBenchmark::methodName(i));
+            json.add("cycles", result.cycles);
+            json.add("bytes", result.bytes);
+            json.add("working_memory", result.workingMemory);
+            json.add("heap_used", result.heapUsed);
+            json.endObject();
+        }
+        json.endObject();
+
+        request->send(response);
+    });
+
+    // API: Configurar ajustes del sistema. Every setting becomes a command for the control
+    // task; the response tells which ones were queued and which were rejected
     webServer.on("/api/settings", HTTP_POST,
         [](AsyncWebServerRequest *request){},
         nullptr,
@@ -262,45 +889,90 @@ void setup() {
                 DeserializationError error = deserializeJson(doc, data, len);
 
                 if (!error) {
+                    CommandResult results[6];
+                    int count = 0;
+                    auto submit = [&](const Command& command) {
+                        results[count++] = commandQueue.submit(command);
+                    };
+
                     if (doc.containsKey("target_burning_temp")) {
-                        float targetTemp = doc["target_burning_temp"];
-                        airIntake.setTargetTemperature(targetTemp);
-                        logBuffer.log("New target temperature: " + String(targetTemp) + "°C");
+                        submit(makeCommand(Command::SOURCE_WEB, Command::TARGET_TEMPERATURE, 0,
+                                           doc["target_burning_temp"] | NAN));
                     }
 
                     // Handle servo min/max configuration
                     if (doc.containsKey("servo_min")) {
-                        int servoMin = doc["servo_min"];
-                        airIntake.setServoMin(servoMin);
-                        logBuffer.log("New servo minimum position: " + String(servoMin));
+                        submit(makeCommand(Command::SOURCE_WEB, Command::SERVO_MIN, 0, doc["servo_min"] | NAN));
                     }
 
                     if (doc.containsKey("servo_max")) {
-                        int servoMax = doc["servo_max"];
-                        airIntake.setServoMax(servoMax);
-                        logBuffer.log("New servo maximum position: " + String(servoMax));
+                        submit(makeCommand(Command::SOURCE_WEB, Command::SERVO_MAX, 0, doc["servo_max"] | NAN));
                     }
 
-                    // Handle PID auto-tuning request
-                    if (doc.containsKey("autotune") && doc["autotune"].as<bool>()) {
-                        if (airIntake.isAutoTuning()) {
-                            // If there's already an auto-tuning in progress, cancel it
-                            airIntake.cancelAutoTune();
-                            logBuffer.log("PID auto-tuning canceled");
+                    // Handle per-channel sampling and filter configuration (missing values are kept)
+                    if (doc.containsKey("sensor_filter")) {
+                        JsonObject filter = doc["sensor_filter"];
+                        submit(makeCommand(Command::SOURCE_WEB, Command::SENSOR_FILTER,
+                                           sensorChannelFromName(filter["channel"] | ""),
+                                           filter["sample_period"] | NAN, filter["median_window"] | NAN,
+                                           filter["iir_alpha"] | NAN));
+                    }
+
+                    // Handle two-point sensor calibration
+                    if (doc.containsKey("calibration")) {
+                        JsonObject cal = doc["calibration"];
+                        int channel = sensorChannelFromName(cal["channel"] | "");
+                        if (cal["reset"] | false) {
+                            submit(makeCommand(Command::SOURCE_WEB, Command::CALIBRATION_RESET, channel));
                         } else {
-                            // Start new auto-tuning
-                            if (airIntake.startAutoTune()) {
-                                logBuffer.log("Starting PID auto-tuning. This may take several minutes...");
-                            } else {
-                                logBuffer.log("Could not start PID auto-tuning");
-                            }
+                            submit(makeCommand(Command::SOURCE_WEB, Command::CALIBRATION, channel,
+                                               cal["measured_low"] | 0.0f, cal["reference_low"] | 0.0f,
+                                               cal["measured_high"] | 0.0f, cal["reference_high"] | 0.0f));
                         }
                     }
 
+                    // Handle PID auto-tuning request (starts it, or cancels the one in progress)
+                    if (doc.containsKey("autotune") && doc["autotune"].as<bool>()) {
+                        submit(makeCommand(Command::SOURCE_WEB, Command::AUTOTUNE));
+                    }
+
+                    bool success = true;
                     AsyncResponseStream *response = request->beginResponseStream("application/json");
-                    StaticJsonDocument<64> respDoc;
-                    respDoc["success"] = true;
-                    serializeJson(respDoc, *response);
+                    JsonWriter json(*response);
+                    json.beginObject();
+
+                    // Handle runtime log levels per source, e.g. {"log_levels": {"mqtt": "debug"}}.
+                    // Applied at once, they are not control task state
+                    if (doc.containsKey("log_levels")) {
+                        json.beginObject("log_levels");
+                        for (JsonPair level : doc["log_levels"].as<JsonObject>()) {
+                            uint8_t source = logSourceFromName(level.key().c_str());
+                            uint8_t value = logLevelFromName(level.value() | "");
+                            if (source == LOG_SOURCE_COUNT || value == 0) {
+                                LOG_WARN(MSG_SETTING_REJECTED, "log_levels", level.key().c_str());
+                                success = false;
+                                json.add(level.key().c_str(), (const char*)nullptr);
+                                continue;
+                            }
+                            logBuffer.setLevel(source, value);
+                            json.add(level.key().c_str(), logLevelName(logBuffer.getLevel(source)));
+                        }
+                        json.endObject();
+                    }
+
+                    json.beginArray("commands");
+                    for (int i = 0; i < count; i++) {
+                        if (results[i].status == CommandResult::STATUS_REJECTED) {
+                            LOG_WARN(MSG_SETTING_REJECTED, Command::typeName(results[i].type), results[i].reason);
+                            success = false;
+                        }
+                        json.beginObject();
+                        writeCommandResult(json, results[i]);
+                        json.endObject();
+                    }
+                    json.endArray();
+                    json.add("success", success);
+                    json.endObject();
                     request->send(response);
                 } else {
                     request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid JSON\"}");
@@ -311,51 +983,55 @@ void setup() {
         }
     );
 
+    // API: Outcome of the last external commands and queue counters
+    webServer.on("/api/commands", HTTP_GET, [](AsyncWebServerRequest *request){
+        AsyncResponseStream *response = request->beginResponseStream("application/json");
+
+        CommandQueue::History history;
+        commandQueue.getHistory(history);
+        SystemState state;
+        systemState.read(state);
+
+        JsonWriter json(*response);
+        json.beginObject();
+        writeCommandStats(json, state.commands);
+        json.beginArray("recent");
+        for (int i = 0; i < history.count; i++) {
+            json.beginObject();
+            writeCommandResult(json, history.results[i]);
+            json.endObject();
+        }
+        json.endArray();
+        json.endObject();
+
+        request->send(response);
+    });
+
+    // API: Live state and log stream (Server-Sent Events), see LiveEvents
+    liveEvents.begin(webServer);
+
     // Iniciar el servidor web después de configurar todas las rutas
     webServer.begin();
-    logBuffer.log("Web server started on port " + String(WEB_SERVER_PORT));
+    LOG_INFO(MSG_WEB_SERVER_STARTED, WEB_SERVER_PORT);
 
     // Set display to toggle screens every 5 seconds
     display.setScreenToggleInterval(5000);
 
-    logBuffer.log("System ready!");
+    LOG_INFO(MSG_SYSTEM_READY);
 }
 
 void loop() {
     unsigned long currentMillis = millis();
 
+    // State of the last control cycle, shared by everything below
+    SystemState state;
+    uint32_t sequence = systemState.read(state);
+
     // Update network manager (handles WiFi connection, MQTT reconnection and OTA)
     networkManager.update();
 
-    // Read sensors every second
-    if (currentMillis - lastSensorRead >= 1000) {
-        lastSensorRead = currentMillis;
-
-        // Read all sensors
-        readSensors();
-
-        // Check operation conditions
-        bool isBurning = sensors.isBurning();
-        bool isBoilerWaterHot = sensors.isBoilerWaterHot();
-        bool isBoilerWaterCritical = sensors.isBoilerWaterCritical();
-
-        // Handle different system states
-        if (isBoilerWaterCritical) {
-            // Emergency mode - critical temperature
-            handleCriticalTemperature();
-        } else {
-            // Normal operation
-            handleNormalOperation(isBurning, isBoilerWaterHot);
-        }
-    }
-
-    // Update air intake control
-    if (currentMillis - lastControlUpdate >= PID_SAMPLE_TIME && !killSwitchActive) {
-        lastControlUpdate = currentMillis;
-
-        // In normal mode, update PID and servo
-        airIntake.update(burningTemp);
-    }
+    // Calibrations applied by the control task are written to flash here, off its deadline
+    sensors.saveCalibrationChanges();
 
     // Update display every 500ms
     if (currentMillis - lastDisplayUpdate >= 500) {
@@ -363,25 +1039,31 @@ void loop() {
 
         // Update display with current values
         display.update(
-            boilerWaterTemp,
-            heatingTemp,
-            burningTemp,
-            ambientTemp,
-            boilerPumpRelay.getState(),
-            heatingPumpRelay.getState(),
-            fansRelay.getState(),
-            airIntake.getTargetTemperature(),
-            airIntake.getCurrentOutput()
+            state.sensors,
+            state.boilerPump,
+            state.heatingPump,
+            state.fans,
+            state.targetBurningTemp,
+            state.airIntake
         );
     }
 
-    // Update MQTT for Home Assistant every 10 seconds
-    if (currentMillis - lastMqttUpdate >= MQTT_PUBLISH_INTERVAL) {
+    // Publish state changes to Home Assistant
+    if (currentMillis - lastMqttUpdate >= MQTT_CHECK_INTERVAL) {
         lastMqttUpdate = currentMillis;
 
-        // Only try to update MQTT if there is WiFi
-        if (networkManager.isConnected()) {
-            updateHomeAssistant();
+        updateHomeAssistant(state);
+        acknowledgeCommands();
+    }
+
+    // Serialize the status JSON once per control cycle, for every web client, and push
+    // the changes to the live event stream
+    if (sequence != statusSequence) {
+        statusSequence = sequence;
+        writeStatus(statusCache.begin(), state);
+        if (!statusCache.commit() && statusCache.getOverflows() == 1) {
+            LOG_WARN(MSG_STATUS_JSON_OVERFLOW);
         }
+        liveEvents.update(state, statusCache, logBuffer);
     }
 }
\ No newline at end of file
@@ -0,0 +1,79 @@
+// Closed-loop benchmark of the air intake PID and auto-tuner against the simulated
+// boiler, on the host: numbers for every scenario before flashing anything.
+// pio test -e native -f test_control_benchmark
+#include <unity.h>
+#include "control_benchmark.h"
+
+static const float DURATION = SIM_SCENARIO_DURATION;
+
+void setUp() {}
+void tearDown() {}
+
+// Settling time is -1 (never settles) or inside the run
+static void checkSettling(const ControlBenchmark::Result& result) {
+    TEST_ASSERT_TRUE(result.settlingTime == -1 ||
+                     (result.settlingTime >= 0 && result.settlingTime <= DURATION));
+}
+
+static void report(const char* gains, int scenario, const ControlBenchmark::Result& result) {
+    char message[160];
+    if (scenario == ControlBenchmark::SCENARIO_AUTOTUNE) {
+        snprintf(message, sizeof(message), "%s %-14s autotune %.0f s, Kp %.3f Ki %.4f Kd %.3f, servo travel %.0f %%",
+                 gains, ControlBenchmark::scenarioName(scenario), result.autotuneTime, result.kp, result.ki,
+                 result.kd, result.servoTravel);
+    } else {
+        snprintf(message, sizeof(message), "%s %-14s IAE %.0f C*s, overshoot %.2f C, settling %.0f s, servo travel %.0f %%",
+                 gains, ControlBenchmark::scenarioName(scenario), result.iae, result.overshoot,
+                 result.settlingTime, result.servoTravel);
+    }
+    TEST_MESSAGE(message);
+}
+
+// Every scenario with the default gains (config.h)
+void test_scenarios_with_default_gains() {
+    for (int i = 0; i < ControlBenchmark::SCENARIO_COUNT; i++) {
+        ControlBenchmark::Result result =
+            ControlBenchmark::run(i, PID_KP, PID_KI, PID_KD, DEFAULT_TARGET_BURNING_TEMP);
+        report("default", i, result);
+        if (i != ControlBenchmark::SCENARIO_AUTOTUNE) {
+            checkSettling(result);
+        }
+        TEST_ASSERT_TRUE(result.servoTravel >= 0);
+    }
+}
+
+// The auto-tuner converges on the simulated plant, and its gains settle every scenario.
+// The cold start is measured from the start of the run, with the firebox at ambient
+void test_scenarios_with_autotuned_gains() {
+    ControlBenchmark::Result tuned = ControlBenchmark::run(ControlBenchmark::SCENARIO_AUTOTUNE, PID_KP, PID_KI,
+                                                           PID_KD, DEFAULT_TARGET_BURNING_TEMP);
+    TEST_ASSERT_TRUE(tuned.autotuneTime > 0);
+    TEST_ASSERT_TRUE(tuned.kp > 0);
+
+    for (int i = 0; i < ControlBenchmark::SCENARIO_AUTOTUNE; i++) {
+        ControlBenchmark::Result result =
+            ControlBenchmark::run(i, tuned.kp, tuned.ki, tuned.kd, DEFAULT_TARGET_BURNING_TEMP);
+        report("tuned  ", i, result);
+        checkSettling(result);
+        TEST_ASSERT_TRUE(result.settlingTime > 0);
+    }
+}
+
+// An error that never leaves the band has settled at once, instead of underflowing
+void test_settling_is_zero_when_never_outside_band() {
+    // A firebox this slow barely moves in one simulated hour
+    BoilerSimulator::Params params = BoilerSimulator::defaultParams();
+    params.timeConstant = 1e7;
+
+    ControlBenchmark::Result result = ControlBenchmark::run(ControlBenchmark::SCENARIO_FUEL_LOAD, PID_KP, PID_KI,
+                                                            PID_KD, DEFAULT_TARGET_BURNING_TEMP, params);
+    TEST_ASSERT_EQUAL_FLOAT(0, result.settlingTime);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_scenarios_with_default_gains);
+    RUN_TEST(test_scenarios_with_autotuned_gains);
+    RUN_TEST(test_settling_is_zero_when_never_outside_band);
+    return UNITY_END();
+}
@@ -0,0 +1,144 @@
+// LogBuffer on the host: logging and reading the log never touch the heap, and every
+// message of log_messages.h formats into one line.
+// pio test -e native -f test_log_buffer
+#include <unity.h>
+#include <cstdlib>
+#include <new>
+#include "log_buffer.h"
+
+LogBuffer logBuffer;
+
+// Every heap allocation of the test program goes through here
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* memory = malloc(size ? size : 1);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    free(memory);
+}
+
+// Relay names as the firmware passes them (Relay::getName())
+static const char* const RELAY_NAME = "Boiler Pump";
+
+void setUp() {
+    logBuffer.clear();
+    logBuffer.setLevel(LOG_SOURCE_COMMANDS, LOG_LEVEL_INFO);
+}
+
+void tearDown() {}
+
+// Copy the whole log as text
+static size_t readAll(char* out, size_t size) {
+    LogBuffer::Cursor cursor = logBuffer.read(0);
+    size_t length = 0;
+    size_t chunk;
+    while ((chunk = logBuffer.copy(cursor, (uint8_t*)out + length, size - 1 - length)) > 0) {
+        length += chunk;
+    }
+    out[length] = '\0';
+    return length;
+}
+
+// The calls made by applyCommand() and the control task: strings, integers and floats
+void test_log_does_not_allocate() {
+    size_t before = allocations;
+    LOG_INFO(MSG_RELAY_STATE, RELAY_NAME, " from MQTT", "ON");
+    LOG_INFO(MSG_SERVO_MIN, 42);
+    LOG_INFO(MSG_SENSOR_FILTER, "burning", 250UL, 5, 0.25f);
+    LOG_WARN(MSG_SAFETY_REACTION, (uint32_t)1200);
+    LOG_DEBUG(MSG_SERVO_MAX, 120);   // Below the runtime level, not even evaluated
+    TEST_ASSERT_EQUAL(0, allocations - before);
+}
+
+void test_read_does_not_allocate() {
+    LOG_INFO(MSG_RELAY_STATE, RELAY_NAME, "", "OFF");
+    LOG_INFO(MSG_SENSOR_FILTER, "heating", 1000UL, 3, 0.5f);
+
+    char text[LOG_ARENA_SIZE];
+    size_t before = allocations;
+    readAll(text, sizeof(text));
+    TEST_ASSERT_EQUAL(0, allocations - before);
+
+    TEST_ASSERT_NOT_NULL(strstr(text, "INFO  commands: Boiler Pump state: OFF\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "New sensor filter for heating: period 1000 ms, median 3, alpha 0.50\n"));
+}
+
+// Every message with the longest string arguments, or numbers where it expects them:
+// one line each, cut at LOG_LINE_SIZE
+void test_every_message_formats() {
+    char longest[LOG_MAX_STRING + 8];
+    memset(longest, 'x', sizeof(longest) - 1);
+    longest[sizeof(longest) - 1] = '\0';
+
+    for (int message = 0; message < MSG_COUNT; message++) {
+        logBuffer.clear();
+        logBuffer.log(LOG_LEVEL_INFO, (LogMessage)message, longest, 123456789, -1.5f, longest, 7UL, longest);
+
+        char text[LOG_LINE_SIZE * 2];
+        size_t length = readAll(text, sizeof(text));
+        TEST_ASSERT_TRUE(length > 0 && length <= LOG_LINE_SIZE);
+        TEST_ASSERT_EQUAL_INT('\n', text[length - 1]);
+        TEST_ASSERT_EQUAL_PTR(text + length - 1, strchr(text, '\n'));
+    }
+}
+
+// A cursor kept across reads, as LogDrain and LogStore do, while the arena wraps and
+// drops records under it: every message comes out once, in order, or is counted lost
+void test_cursor_follows_wraparound() {
+    LogBuffer::Cursor cursor = logBuffer.read(logBuffer.getSequence());
+    int logged = 0;
+    int expected = 0;
+    int lines = 0;
+    for (int round = 0; round < 200; round++) {
+        int batch = round % 10 == 9 ? 400 : round % 7 + 1;   // Now and then more than fits
+        for (int i = 0; i < batch; i++) {
+            LOG_INFO(MSG_SERVO_MIN, logged++);
+        }
+
+        cursor.end = logBuffer.getSequence();
+        char text[LOG_LINE_SIZE * 3 + 1];
+        size_t length;
+        while ((length = logBuffer.copy(cursor, (uint8_t*)text, sizeof(text) - 1)) > 0) {
+            text[length] = '\0';
+            for (char* line = strstr(text, "position: "); line; line = strstr(line + 1, "position: ")) {
+                int value = atoi(line + strlen("position: "));
+                TEST_ASSERT_TRUE(value >= expected);
+                expected = value + 1;
+                lines++;
+            }
+        }
+        TEST_ASSERT_EQUAL_INT(logged, expected);
+        TEST_ASSERT_EQUAL_INT(logged, lines + (int)cursor.lost);
+    }
+    TEST_ASSERT_TRUE(cursor.lost > 0);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_log_does_not_allocate);
+    RUN_TEST(test_read_does_not_allocate);
+    RUN_TEST(test_every_message_formats);
+    RUN_TEST(test_cursor_follows_wraparound);
+    return UNITY_END();
+}
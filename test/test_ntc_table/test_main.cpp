@@ -0,0 +1,122 @@
+// Accuracy and speed of the NTC lookup table against the Steinhart-Hart formula.
+// pio test -e native -f test_ntc_table
+#include <unity.h>
+#include <chrono>
+#include "ntc_table.h"
+
+// Steinhart-Hart in double precision with the C library logarithm
+static double reference(double rawADC) {
+    double resistor = NTC_SERIES_RESISTOR / ((double)NtcTable::ADC_MAX / rawADC - 1.0);
+    double logR = std::log(resistor);
+    return 1.0 / (NtcTable::C1 + NtcTable::C2 * logR + NtcTable::C3 * logR * logR * logR) - 273.15;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Every ADC code: the table matches the reference to float precision
+void test_table_matches_reference_over_adc_range() {
+    double worst = 0;
+    int worstCode = 0;
+    for (int code = 1; code < NtcTable::ADC_MAX; code++) {
+        double error = fabs(NtcTable::lookup(code) - reference(code));
+        if (error > worst) {
+            worst = error;
+            worstCode = code;
+        }
+    }
+
+    char message[80];
+    snprintf(message, sizeof(message), "table worst error %.6f C at code %d", worst, worstCode);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.001, worst);
+}
+
+// The runtime float formula it replaces is no more accurate
+void test_formula_error_over_adc_range() {
+    double worstTable = 0;
+    double worstFormula = 0;
+    for (int code = 1; code < NtcTable::ADC_MAX; code++) {
+        worstTable = max(worstTable, fabs(NtcTable::lookup(code) - reference(code)));
+        worstFormula = max(worstFormula, fabs(NtcTable::steinhartHart(code) - reference(code)));
+    }
+
+    char message[80];
+    snprintf(message, sizeof(message), "float formula worst error %.6f C", worstFormula);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(worstTable <= worstFormula);
+}
+
+// Filtered readings fall between codes: interpolation error over the whole range,
+// bounded tightly where the sensors operate (-30 to 200 C)
+void test_interpolation_between_codes() {
+    double worst = 0;
+    double worstInRange = 0;
+    for (int code = 1; code < NtcTable::ADC_MAX - 1; code++) {
+        for (double fraction = 0.25; fraction < 1; fraction += 0.25) {
+            double raw = code + fraction;
+            double expected = reference(raw);
+            double error = fabs(NtcTable::lookup(raw) - expected);
+            worst = max(worst, error);
+            if (expected > -30 && expected < 200) {
+                worstInRange = max(worstInRange, error);
+            }
+        }
+    }
+
+    char message[96];
+    snprintf(message, sizeof(message), "interpolation worst error %.4f C (whole range), %.4f C (-30..200 C)",
+             worst, worstInRange);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.01, worstInRange);
+    TEST_ASSERT_LESS_THAN_FLOAT(20, worst);
+}
+
+// Rails and out-of-range readings are faults, not temperatures
+void test_rails_are_nan() {
+    TEST_ASSERT_TRUE(isnan(NtcTable::lookup(0)));
+    TEST_ASSERT_TRUE(isnan(NtcTable::lookup(NtcTable::ADC_MAX)));
+    TEST_ASSERT_TRUE(isnan(NtcTable::lookup(-1)));
+    TEST_ASSERT_TRUE(isnan(NtcTable::lookup(NAN)));
+    TEST_ASSERT_TRUE(isnan(NtcTable::steinhartHart(0)));
+}
+
+// Host timing of both conversions over the ADC range. Absolute numbers differ on the
+// ESP32-S2 (no FPU), where the formula is far slower; this only shows the ratio
+void test_benchmark() {
+    const int rounds = 200;
+    volatile float sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (int code = 1; code < NtcTable::ADC_MAX; code++) {
+            sink = sink + NtcTable::lookup(code + 0.5f);
+        }
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (int code = 1; code < NtcTable::ADC_MAX; code++) {
+            sink = sink + NtcTable::steinhartHart(code + 0.5f);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double calls = (double)rounds * (NtcTable::ADC_MAX - 1);
+    double tableNs = std::chrono::duration<double, std::nano>(middle - start).count() / calls;
+    double formulaNs = std::chrono::duration<double, std::nano>(end - middle).count() / calls;
+
+    char message[96];
+    snprintf(message, sizeof(message), "lookup %.1f ns/call, Steinhart-Hart %.1f ns/call", tableNs, formulaNs);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(tableNs > 0 && formulaNs > 0);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_table_matches_reference_over_adc_range);
+    RUN_TEST(test_formula_error_over_adc_range);
+    RUN_TEST(test_interpolation_between_codes);
+    RUN_TEST(test_rails_are_nan);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,206 @@
+// PIDController (float and Q16.16) against br3ttb's PID_v1: identical step responses
+// and time per compute.
+// pio test -e native -f test_pid_controller
+#include <unity.h>
+#include <chrono>
+#include "pid_controller.h"
+
+// PID_v1 1.2.1 with its defaults (P_ON_E, DIRECT, 100 ms, limits 0-255): Compute(),
+// SetTunings(), SetOutputLimits() and Initialize() as in the library, in double, with
+// the time passed in instead of read from millis()
+class PidV1 {
+public:
+    PidV1(double kp, double ki, double kd, unsigned long now)
+        : outMin(0), outMax(255), sampleTime(100), inAuto(false), outputSum(0), lastInput(0), output(0) {
+        setTunings(kp, ki, kd);
+        lastTime = now - sampleTime;
+    }
+
+    void setTunings(double newKp, double newKi, double newKd) {
+        double sampleTimeSec = (double)sampleTime / 1000;
+        kp = newKp;
+        ki = newKi * sampleTimeSec;
+        kd = newKd / sampleTimeSec;
+    }
+
+    void setOutputLimits(double min, double max) {
+        outMin = min;
+        outMax = max;
+    }
+
+    void setAutomatic(double input, double currentOutput) {
+        output = currentOutput;
+        outputSum = clamp(output);
+        lastInput = input;
+        inAuto = true;
+    }
+
+    bool compute(double input, double setpoint, unsigned long now) {
+        if (!inAuto || now - lastTime < sampleTime) return false;
+
+        double error = setpoint - input;
+        double dInput = input - lastInput;
+        outputSum = clamp(outputSum + ki * error);
+        output = clamp(kp * error + outputSum - kd * dInput);
+
+        lastInput = input;
+        lastTime = now;
+        return true;
+    }
+
+    double getOutput() const { return output; }
+
+private:
+    double clamp(double value) const {
+        if (value > outMax) return outMax;
+        if (value < outMin) return outMin;
+        return value;
+    }
+
+    double kp, ki, kd;
+    double outMin, outMax;
+    unsigned long sampleTime;
+    unsigned long lastTime;
+    bool inAuto;
+    double outputSum;
+    double lastInput;
+    double output;
+};
+
+// First order process, e.g. the firebox answering to the air intake
+struct Plant {
+    float value;
+
+    void step(float output, float seconds) {
+        value += (20.0f + 2.0f * output - value) * seconds / 60.0f;
+    }
+};
+
+static const float KP = 2.0, KI = 0.5, KD = 1.0;
+static const float SETPOINT_STEP = 80.0;
+
+void setUp() {}
+void tearDown() {}
+
+// Closed loop setpoint step with the controller under test and PID_v1 side by side,
+// each driving its own plant. Returns the largest output difference
+template <typename T>
+static float stepResponseDifference() {
+    PIDController<T> pid(KP, KI, KD);
+    pid.setSampleTime(100);
+    pid.setOutputLimits(0, 100);
+    pid.setMode(PIDController<T>::AUTOMATIC, 20, 0);
+
+    PidV1 reference(KP, KI, KD, 0);
+    reference.setOutputLimits(0, 100);
+    reference.setAutomatic(20, 0);
+
+    Plant plant = {20};
+    Plant referencePlant = {20};
+    float worst = 0;
+
+    for (unsigned long now = 0; now <= 600000; now += 100) {
+        float setpoint = now < 1000 ? 20 : SETPOINT_STEP;
+        bool computed = pid.compute(plant.value, setpoint, now);
+        bool referenceComputed = reference.compute(referencePlant.value, setpoint, now);
+        TEST_ASSERT_EQUAL(referenceComputed, computed);
+
+        worst = max(worst, (float)fabs(pid.getOutput() - reference.getOutput()));
+        plant.step(pid.getOutput(), 0.1f);
+        referencePlant.step(reference.getOutput(), 0.1f);
+    }
+
+    TEST_ASSERT_FLOAT_WITHIN(0.5, SETPOINT_STEP, plant.value);
+    return worst;
+}
+
+void test_float_step_response_matches_pid_v1() {
+    float worst = stepResponseDifference<float>();
+    char message[64];
+    snprintf(message, sizeof(message), "float: largest output difference %.6f", worst);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.005, worst);
+}
+
+void test_fixed_step_response_matches_pid_v1() {
+    float worst = stepResponseDifference<Fixed16>();
+    char message[64];
+    snprintf(message, sizeof(message), "Q16.16: largest output difference %.6f", worst);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.02, worst);
+}
+
+// Sample time is respected the same way: no second compute within 100 ms
+void test_sample_time() {
+    PIDController<float> pid(KP, KI, KD);
+    pid.setOutputLimits(0, 100);
+    pid.setMode(PIDController<float>::AUTOMATIC, 20, 0);
+    TEST_ASSERT_TRUE(pid.compute(20, 50, 1000));
+    TEST_ASSERT_FALSE(pid.compute(20, 50, 1099));
+    TEST_ASSERT_TRUE(pid.compute(20, 50, 1100));
+}
+
+// Out of range and NaN values saturate instead of overflowing
+void test_fixed_saturation() {
+    TEST_ASSERT_EQUAL_INT32(INT32_MAX, Fixed16(1e9f).getRaw());
+    TEST_ASSERT_EQUAL_INT32(INT32_MIN, Fixed16(-1e9f).getRaw());
+    TEST_ASSERT_EQUAL_INT32(INT32_MAX, Fixed16(INFINITY).getRaw());
+    TEST_ASSERT_EQUAL_INT32(0, Fixed16(NAN).getRaw());
+    TEST_ASSERT_EQUAL_INT32(INT32_MAX, Fixed16(100000).getRaw());
+    TEST_ASSERT_EQUAL_INT32(98304, Fixed16(1.5f).getRaw());
+    TEST_ASSERT_EQUAL_INT32(-98304, Fixed16(-1.5f).getRaw());
+    TEST_ASSERT_EQUAL_INT32(INT32_MAX, (-Fixed16::fromRaw(INT32_MIN)).getRaw());
+    TEST_ASSERT_EQUAL_INT32(-INT32_MAX, (-Fixed16::fromRaw(INT32_MAX)).getRaw());
+}
+
+// Time per compute on the host. The ESP32-S2 has no FPU, so there double and float
+// are both soft-float and the gap to Q16.16 is far wider than here
+template <typename Controller, typename Compute>
+static double nanosecondsPerCompute(Controller& controller, Compute compute) {
+    const unsigned long runs = 1000000;
+    volatile float input = 50;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < runs; i++) {
+        compute(controller, input + (i & 7), (i + 1) * 100);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / runs;
+}
+
+void test_benchmark() {
+    PidV1 reference(KP, KI, KD, 0);
+    reference.setOutputLimits(0, 100);
+    reference.setAutomatic(50, 50);
+    PIDController<float> floatPid(KP, KI, KD);
+    floatPid.setOutputLimits(0, 100);
+    floatPid.setMode(PIDController<float>::AUTOMATIC, 50, 50);
+    PIDController<Fixed16> fixedPid(KP, KI, KD);
+    fixedPid.setOutputLimits(0, 100);
+    fixedPid.setMode(PIDController<Fixed16>::AUTOMATIC, 50, 50);
+
+    double referenceNs = nanosecondsPerCompute(reference, [](PidV1& pid, float input, unsigned long now) {
+        pid.compute(input, 60, now);
+    });
+    double floatNs = nanosecondsPerCompute(floatPid, [](PIDController<float>& pid, float input, unsigned long now) {
+        pid.compute(input, 60, now);
+    });
+    double fixedNs = nanosecondsPerCompute(fixedPid, [](PIDController<Fixed16>& pid, float input, unsigned long now) {
+        pid.compute(input, 60, now);
+    });
+
+    char message[96];
+    snprintf(message, sizeof(message), "PID_v1 (double) %.1f ns, float %.1f ns, Q16.16 %.1f ns per compute",
+             referenceNs, floatNs, fixedNs);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(referenceNs > 0 && floatNs > 0 && fixedNs > 0);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_float_step_response_matches_pid_v1);
+    RUN_TEST(test_fixed_step_response_matches_pid_v1);
+    RUN_TEST(test_sample_time);
+    RUN_TEST(test_fixed_saturation);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,109 @@
+// StatusCache on the host: JSON that does not fit is dropped without touching the published
+// one, and a reader is told to retry whenever the writer reached its buffer, also when
+// JSON was dropped in between.
+// pio test -e native -f test_status_cache
+#include <unity.h>
+#include <string>
+#include "status_cache.h"
+
+StatusCache* cache;
+
+void setUp() {
+    cache = new StatusCache();
+}
+
+void tearDown() {
+    delete cache;
+}
+
+static bool publish(const char* json) {
+    cache->begin().write(json);
+    return cache->commit();
+}
+
+// A JSON of STATUS_JSON_SIZE + 1 bytes, written in chunks so that part of it lands in the
+// buffer before the overflow
+static bool publishTooLong() {
+    Print& out = cache->begin();
+    for (int i = 0; i <= STATUS_JSON_SIZE; i++) {
+        out.write((uint8_t)'x');
+    }
+    return cache->commit();
+}
+
+static std::string readJson(bool* complete = nullptr) {
+    std::string json;
+    bool done = cache->read([&](const char* text, size_t length) {
+        json.assign(text, length);
+    });
+    if (complete) *complete = done;
+    return json;
+}
+
+void test_empty_until_first_json() {
+    TEST_ASSERT_TRUE(cache->isEmpty());
+    TEST_ASSERT_FALSE(publishTooLong());
+    TEST_ASSERT_TRUE(cache->isEmpty());
+    TEST_ASSERT_EQUAL_STRING("", readJson().c_str());
+
+    TEST_ASSERT_TRUE(publish("{\"a\":1}"));
+    TEST_ASSERT_FALSE(cache->isEmpty());
+    TEST_ASSERT_EQUAL_STRING("{\"a\":1}", readJson().c_str());
+}
+
+void test_overflow_keeps_published_json() {
+    TEST_ASSERT_TRUE(publish("{\"a\":1}"));
+    TEST_ASSERT_TRUE(publish("{\"a\":2}"));
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_FALSE(publishTooLong());
+        bool complete;
+        TEST_ASSERT_EQUAL_STRING("{\"a\":2}", readJson(&complete).c_str());
+        TEST_ASSERT_TRUE(complete);
+    }
+    TEST_ASSERT_EQUAL(3, cache->getOverflows());
+
+    TEST_ASSERT_TRUE(publish("{\"a\":3}"));
+    TEST_ASSERT_EQUAL_STRING("{\"a\":3}", readJson().c_str());
+}
+
+// The writer runs while the reader is inside read(): drop a JSON, publish one, then drop
+// one into the buffer being read. Counting the drops back down would leave the sequence
+// where the reader started and hide the overwrite
+void test_reader_retries_after_overflow() {
+    TEST_ASSERT_TRUE(publish("{\"a\":1}"));
+
+    std::string json;
+    bool complete = cache->read([&](const char* text, size_t length) {
+        publishTooLong();
+        publish("{\"a\":2}");
+        publishTooLong();
+        json.assign(text, length);
+    });
+    TEST_ASSERT_TRUE(json != "{\"a\":1}");   // Torn
+    TEST_ASSERT_FALSE(complete);
+
+    TEST_ASSERT_EQUAL_STRING("{\"a\":2}", readJson(&complete).c_str());
+    TEST_ASSERT_TRUE(complete);
+}
+
+// A publish during the read never touches the buffer being read
+void test_reader_keeps_json_across_one_publish() {
+    TEST_ASSERT_TRUE(publish("{\"a\":1}"));
+
+    std::string json;
+    bool complete = cache->read([&](const char* text, size_t length) {
+        publish("{\"a\":2}");
+        json.assign(text, length);
+    });
+    TEST_ASSERT_EQUAL_STRING("{\"a\":1}", json.c_str());
+    TEST_ASSERT_TRUE(complete);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_until_first_json);
+    RUN_TEST(test_overflow_keeps_published_json);
+    RUN_TEST(test_reader_retries_after_overflow);
+    RUN_TEST(test_reader_keeps_json_across_one_publish);
+    return UNITY_END();
+}